@@ -90,7 +90,7 @@ ok_load_setup:
     int $0x10
 
 .equ SYSSEG, 0x1000                     # linux内核镜像加载地址
-.equ SYSSIZE, 0x3000                    # linux内核镜像大小
+.equ SYSSIZE, 0x4000                    # linux内核镜像大小（256KB）
 .equ ENDSEG, SYSSEG + SYSSIZE           # linux内核镜像结束地址
 
 # 加载 Linux 内核镜像
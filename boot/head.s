@@ -275,7 +275,7 @@ idt_descr:
 .align 2
     .word 0
 gdt_descr:
-    .word 256*8-1                      # 定义 GDT 表的界限，256 个条目，每个条目 8 字节
+    .word 516*8-1                      # 定义 GDT 表的界限，4 + 2*NR_TASKS 个条目（NR_TASKS 见 sched.h），每个条目 8 字节
     .long gdt                          # 定义 GDT 表的基地址
 
 .align 8                              # 按 8 字节对齐
@@ -284,7 +284,7 @@ idt:
 
 gdt:
     .quad 0x0000000000000000            # 定义 GDT 的第一个条目，空描述符
-    .quad 0x00c09a0000000fff            # 定义代码段描述符，00c0 ; 9a00 (1 00 1 1 0 1 0 00000000); 0000 段起始地址; 0fff limit 对应 4096，页 4KB，共 16MB
-    .quad 0x00c0920000000fff            # 定义数据段描述符，00c0 ; 9200 (1 00 1 0 0 1 0 00000000); 0000 段起始地址; 0fff limit 对应 4096，页 4KB，共 16MB
+    .quad 0x00cf9a000000ffff            # 定义代码段描述符，00cf ; 9a00 (1 00 1 1 0 1 0 00000000); 0000 段起始地址; fffff limit，页 4KB，共 4GB（内核可直接访问 16MB 以上的线性地址）
+    .quad 0x00cf92000000ffff            # 定义数据段描述符，00cf ; 9200 (1 00 1 0 0 1 0 00000000); 0000 段起始地址; fffff limit，页 4KB，共 4GB
     .quad 0x0000000000000000            # 临时描述符，暂不使用
-    .fill 252,8,0                       # 填充 252 个条目，每个条目 8 字节，初始值为 0，为 LDT 和 TSS 等预留空间
+    .fill 512,8,0                       # 每个任务一个 TSS 和一个 LDT，共 2*NR_TASKS 个条目，初始值为 0
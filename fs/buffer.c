@@ -20,11 +20,15 @@
 
 #include <stdarg.h>
  
+#include <errno.h>
+
 #include <linux/config.h>
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/bufstat.h>
 #include <asm/system.h>
 #include <asm/io.h>
+#include <asm/segment.h>
 
 extern int end;
 extern void put_super(int);
@@ -35,13 +39,38 @@ struct buffer_head * hash_table[NR_HASH];
 static struct buffer_head * free_list;
 static struct task_struct * buffer_wait = NULL;
 int NR_BUFFERS = 0;
+static struct buffer_stat buffer_stat;
+
+/*
+ * Besides the buffers buffer_init() carves out of low memory, the cache
+ * borrows whole pages from get_free_page() while free memory is
+ * plentiful, and shrink_buffers() returns them when it runs low. The
+ * heads for those buffers live in pages of their own, four heads (one
+ * data page) to a group. A group is empty when its b_data is NULL.
+ * Head pages are never freed, so buffer_nr() stays valid across sleeps.
+ */
+#define HEADS_PER_PAGE ((PAGE_SIZE/sizeof(struct buffer_head)) & ~3)
+#define NR_HEAD_PAGES 64
+
+static struct buffer_head * head_page[NR_HEAD_PAGES];
+static int nr_static_buffers = 0;
+static int nr_buffer_slots = 0;
+static int shrink_next = 0;
+
+static inline struct buffer_head * buffer_nr(int i)
+{
+	if (i < nr_static_buffers)
+		return start_buffer + i;
+	i -= nr_static_buffers;
+	return head_page[i / HEADS_PER_PAGE] + i % HEADS_PER_PAGE;
+}
 
 static inline void wait_on_buffer(struct buffer_head * bh)
 {
-	cli();
-	while (bh->b_lock)
-		sleep_on(&bh->b_wait);
-	sti();
+	if (mutex_locked(&bh->b_lock)) {
+		buffer_stat.lock_waits++;
+		__mutex_wait(&bh->b_lock);
+	}
 }
 
 int sys_sync(void)
@@ -50,8 +79,8 @@ int sys_sync(void)
 	struct buffer_head * bh;
 
 	sync_inodes();		/* write out inodes into buffers */
-	bh = start_buffer;
-	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+	for (i=0 ; i<nr_buffer_slots ; i++) {
+		bh = buffer_nr(i);
 		wait_on_buffer(bh);
 		if (bh->b_dirt)
 			ll_rw_block(WRITE,bh);
@@ -64,8 +93,8 @@ int sync_dev(int dev)
 	int i;
 	struct buffer_head * bh;
 
-	bh = start_buffer;
-	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+	for (i=0 ; i<nr_buffer_slots ; i++) {
+		bh = buffer_nr(i);
 		if (bh->b_dev != dev)
 			continue;
 		wait_on_buffer(bh);
@@ -73,8 +102,8 @@ int sync_dev(int dev)
 			ll_rw_block(WRITE,bh);
 	}
 	sync_inodes();
-	bh = start_buffer;
-	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+	for (i=0 ; i<nr_buffer_slots ; i++) {
+		bh = buffer_nr(i);
 		if (bh->b_dev != dev)
 			continue;
 		wait_on_buffer(bh);
@@ -89,8 +118,8 @@ static void inline invalidate_buffers(int dev)
 	int i;
 	struct buffer_head * bh;
 
-	bh = start_buffer;
-	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+	for (i=0 ; i<nr_buffer_slots ; i++) {
+		bh = buffer_nr(i);
 		if (bh->b_dev != dev)
 			continue;
 		wait_on_buffer(bh);
@@ -205,14 +234,102 @@ struct buffer_head * get_hash_table(int dev, int block)
  *
  * The algoritm is changed: hopefully better, and an elusive bug removed.
  */
-#define BADNESS(bh) (((bh)->b_dirt<<1)+(bh)->b_lock)
+#define BADNESS(bh) (((bh)->b_dirt<<1)+mutex_locked(&(bh)->b_lock))
+
+/*
+ * grow_buffers() adds a page worth of empty buffers to the head of the
+ * free list and returns the first of them, or NULL if memory is too
+ * tight to be given to the cache. It doesn't sleep.
+ */
+static struct buffer_head * grow_buffers(void)
+{
+	struct buffer_head * bh;
+	unsigned long page;
+	int i;
+
+	if (nr_free_pages <= (nr_main_pages >> 2))
+		return NULL;
+	for (i=nr_static_buffers ; i<nr_buffer_slots ; i += 4)
+		if (!buffer_nr(i)->b_data)
+			break;
+	if (i >= nr_buffer_slots) {
+		if (nr_buffer_slots-nr_static_buffers >= NR_HEAD_PAGES*HEADS_PER_PAGE)
+			return NULL;
+		if (!(page = get_free_page()))
+			return NULL;
+		head_page[(i-nr_static_buffers)/HEADS_PER_PAGE] =
+			(struct buffer_head *) page;
+		nr_buffer_slots += HEADS_PER_PAGE;
+	}
+	if (!(page = get_free_page()))
+		return NULL;
+	bh = buffer_nr(i) + 3;
+	page += 3*BLOCK_SIZE;
+	for (i=0 ; i<4 ; i++,bh--,page -= BLOCK_SIZE) {
+		bh->b_dev = 0;
+		bh->b_dirt = 0;
+		bh->b_count = 0;
+		mutex_init(&bh->b_lock);
+		bh->b_uptodate = 0;
+		bh->b_data = (char *) page;
+		insert_into_queues(bh);
+		free_list = bh;
+		NR_BUFFERS++;
+	}
+	buffer_stat.grown++;
+	return free_list;
+}
+
+/*
+ * shrink_buffers() is called by get_free_page() when memory runs low.
+ * It frees up to 'pages' borrowed pages whose four buffers are unused,
+ * clean and unlocked, so it never has to write or sleep. Returns the
+ * number of pages freed.
+ */
+int shrink_buffers(int pages)
+{
+	struct buffer_head * bh;
+	int groups = (nr_buffer_slots-nr_static_buffers) >> 2;
+	int i, j, freed = 0;
+
+	for (i=0 ; i<groups && freed<pages ; i++) {
+		if (shrink_next >= groups)
+			shrink_next = 0;
+		bh = buffer_nr(nr_static_buffers + 4*shrink_next++);
+		if (!bh->b_data)
+			continue;
+		for (j=0 ; j<4 ; j++)
+			if (bh[j].b_count || bh[j].b_dirt ||
+			    mutex_locked(&bh[j].b_lock) || bh[j].b_lock.wait)
+				break;
+		if (j < 4)
+			continue;
+		for (j=0 ; j<4 ; j++) {
+			remove_from_queues(bh+j);
+			bh[j].b_dev = 0;
+			bh[j].b_uptodate = 0;
+			NR_BUFFERS--;
+		}
+		free_page((unsigned long) bh->b_data);
+		for (j=0 ; j<4 ; j++)
+			bh[j].b_data = NULL;
+		freed++;
+	}
+	buffer_stat.shrunk += freed;
+	return freed;
+}
+
 struct buffer_head * getblk(int dev,int block)
 {
 	struct buffer_head * tmp, * bh;
+	int dirty;
 
 repeat:
-	if ((bh = get_hash_table(dev,block)))
+	dirty = 0;
+	if ((bh = get_hash_table(dev,block))) {
+		buffer_stat.getblk_hits++;
 		return bh;
+	}
 	tmp = free_list;
 	do {
 		if (tmp->b_count)
@@ -224,17 +341,23 @@ repeat:
 		}
 /* and repeat until we find something good */
 	} while ((tmp = tmp->b_next_free) != free_list);
+/* rather than drop a cached block or wait, take a page for the cache */
+	if ((!bh || bh->b_dev || BADNESS(bh)) && (tmp = grow_buffers()))
+		bh = tmp;
 	if (!bh) {
+		buffer_stat.buffer_waits++;
 		sleep_on(&buffer_wait);
 		goto repeat;
 	}
 	wait_on_buffer(bh);
-	if (bh->b_count)
+	if (bh->b_count || !bh->b_data)
 		goto repeat;
 	while (bh->b_dirt) {
+		dirty = 1;
+		buffer_stat.evict_syncs++;
 		sync_dev(bh->b_dev);
 		wait_on_buffer(bh);
-		if (bh->b_count)
+		if (bh->b_count || !bh->b_data)
 			goto repeat;
 	}
 /* NOTE!! While we slept waiting for this block, somebody else might */
@@ -243,6 +366,13 @@ repeat:
 		goto repeat;
 /* OK, FINALLY we know that this buffer is the only one of it's kind, */
 /* and that it's unused (b_count=0), unlocked (b_lock=0), and clean */
+	buffer_stat.getblk_misses++;
+	if (bh->b_dev) {
+		if (dirty)
+			buffer_stat.evict_dirty++;
+		else
+			buffer_stat.evict_clean++;
+	}
 	bh->b_count=1;
 	bh->b_dirt=0;
 	bh->b_uptodate=0;
@@ -273,8 +403,11 @@ struct buffer_head * bread(int dev,int block)
 
 	if (!(bh=getblk(dev,block)))
 		panic("bread: getblk returned NULL\n");
-	if (bh->b_uptodate)
+	if (bh->b_uptodate) {
+		buffer_stat.bread_hits++;
 		return bh;
+	}
+	buffer_stat.bread_waits++;
 	ll_rw_block(READ,bh);
 	wait_on_buffer(bh);
 	if (bh->b_uptodate)
@@ -362,9 +495,8 @@ void buffer_init(long buffer_end)
 		h->b_dev = 0;
 		h->b_dirt = 0;
 		h->b_count = 0;
-		h->b_lock = 0;
+		mutex_init(&h->b_lock);
 		h->b_uptodate = 0;
-		h->b_wait = NULL;
 		h->b_next = NULL;
 		h->b_prev = NULL;
 		h->b_data = (char *) b;
@@ -379,6 +511,51 @@ void buffer_init(long buffer_end)
 	free_list = start_buffer;
 	free_list->b_prev_free = h;
 	h->b_next_free = free_list;
+	nr_static_buffers = nr_buffer_slots = NR_BUFFERS;
 	for (i=0;i<NR_HASH;i++)
 		hash_table[i]=NULL;
 }	
+
+int sys_bufstat(struct buffer_stat * st, struct buffer_info * buf, int n)
+{
+	struct buffer_head * bh;
+	struct buffer_info info;
+	int i, j, count = 0;
+
+	if (st == (struct buffer_stat *) -1) {
+		if (!suser())
+			return -EPERM;
+		for (i=0 ; i<sizeof buffer_stat ; i++)
+			((char *) &buffer_stat)[i] = 0;
+		return 0;
+	}
+	if (st) {
+		buffer_stat.nr_buffers = NR_BUFFERS;
+		if (verify_area(st,sizeof *st))
+			return -EFAULT;
+		for (i=0 ; i<sizeof *st ; i++)
+			put_fs_byte(((char *) &buffer_stat)[i],i+(char *) st);
+	}
+	if (!buf || n <= 0)
+		return 0;
+	if (n > nr_buffer_slots)
+		n = nr_buffer_slots;
+	if (verify_area(buf,n * sizeof *buf))
+		return -EFAULT;
+	for (i=0 ; i<nr_buffer_slots && count<n ; i++) {
+		bh = buffer_nr(i);
+		if (!bh->b_dev)
+			continue;
+		info.dev = bh->b_dev;
+		info.count = bh->b_count;
+		info.block = bh->b_blocknr;
+		info.uptodate = bh->b_uptodate;
+		info.dirt = bh->b_dirt;
+		info.lock = mutex_locked(&bh->b_lock);
+		info.unused = 0;
+		for (j=0 ; j<sizeof info ; j++)
+			put_fs_byte(((char *) &info)[j],j+(char *) (buf+count));
+		count++;
+	}
+	return count;
+}
@@ -26,6 +26,7 @@
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/timepage.h>
 #include <asm/segment.h>
 
 extern int sys_exit(int exit_code);
@@ -151,6 +152,11 @@ static unsigned long copy_strings(int argc,char ** argv,unsigned long *page,
 	return p;
 }
 
+/*
+ * change_ldt() sets up the new segments, maps the time page at the top
+ * of the data segment and the argument pages just below it, and
+ * returns the address where the argument pages end.
+ */
 static unsigned long change_ldt(unsigned long text_size,unsigned long * page)
 {
 	unsigned long code_limit,data_limit,code_base,data_base;
@@ -158,7 +164,7 @@ static unsigned long change_ldt(unsigned long text_size,unsigned long * page)
 
 	code_limit = text_size+PAGE_SIZE -1;
 	code_limit &= 0xFFFFF000;
-	data_limit = 0x4000000;
+	data_limit = TASK_SIZE;
 	code_base = get_base(current->ldt[1]);
 	data_base = code_base;
 	set_base(current->ldt[1],code_base);
@@ -167,13 +173,14 @@ static unsigned long change_ldt(unsigned long text_size,unsigned long * page)
 	set_limit(current->ldt[2],data_limit);
 /* make sure fs points to the NEW data segment */
 	__asm__("pushl $0x17\n\tpop %%fs"::);
-	data_base += data_limit;
+	put_kernel_page((unsigned long) &time_page, data_base + TIME_PAGE_ADDR);
+	data_base += TIME_PAGE_ADDR;
 	for (i=MAX_ARG_PAGES-1 ; i>=0 ; i--) {
 		data_base -= PAGE_SIZE;
 		if (page[i])
 			put_page(page[i],data_base);
 	}
-	return data_limit;
+	return TIME_PAGE_ADDR;
 }
 
 /*
@@ -191,6 +198,7 @@ int do_execve(unsigned long * eip,long tmp,char * filename,
 	int retval;
 	int sh_bang = 0;
 	unsigned long p=PAGE_SIZE*MAX_ARG_PAGES-4;
+	struct mm_struct * mm = NULL, * old_mm;
 
 	if ((0xffff & eip[1]) != 0x000f)
 		panic("execve called from supervisor mode");
@@ -315,6 +323,11 @@ restart_interp:
 			goto exec_error2;
 		}
 	}
+/* other threads keep running in the old address space: leave it to them */
+	if (current->mm->users > 1 && !(mm = mm_alloc())) {
+		retval = -ENOMEM;
+		goto exec_error2;
+	}
 /* OK, This is the point of no return */
 	if (current->executable)
 		iput(current->executable);
@@ -322,17 +335,30 @@ restart_interp:
 	for (i=0 ; i<32 ; i++)
 		current->sigaction[i].sa_handler = NULL;
 	for (i=0 ; i<NR_OPEN ; i++)
-		if ((current->close_on_exec>>i)&1)
+		if ((current->files->close_on_exec>>i)&1)
 			sys_close(i);
-	current->close_on_exec = 0;
-	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
-	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
+	current->files->close_on_exec = 0;
+/* the other threads may have exited while we slept: maybe we're last */
+	if (mm) {
+		old_mm = current->mm;
+		exit_mm();
+		current->mm = mm;
+		current->tss.cr3 = mm->pg_dir;
+		__asm__ __volatile__("movl %0,%%cr3"::"r" (mm->pg_dir));
+		mmput(old_mm);
+	} else {
+		exit_mmap(current);
+		free_page_tables(task_pg_dir(current),
+			get_base(current->ldt[1]),get_limit(0x0f));
+		free_page_tables(task_pg_dir(current),
+			get_base(current->ldt[2]),get_limit(0x17));
+	}
 	if (last_task_used_math == current)
 		last_task_used_math = NULL;
 	current->used_math = 0;
 	p += change_ldt(ex.a_text,page)-MAX_ARG_PAGES*PAGE_SIZE;
 	p = (unsigned long) create_tables((char *)p,argc,envc);
-	current->brk = ex.a_bss +
+	current->mm->brk = ex.a_bss +
 		(current->end_data = ex.a_data +
 		(current->end_code = ex.a_text));
 	current->start_stack = p & 0xfffff000;
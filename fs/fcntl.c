@@ -17,19 +17,19 @@ extern int sys_close(int fd);
 
 static int dupfd(unsigned int fd, unsigned int arg)
 {
-	if (fd >= NR_OPEN || !current->filp[fd])
+	if (fd >= NR_OPEN || !current->files->fd[fd])
 		return -EBADF;
 	if (arg >= NR_OPEN)
 		return -EINVAL;
 	while (arg < NR_OPEN)
-		if (current->filp[arg])
+		if (current->files->fd[arg])
 			arg++;
 		else
 			break;
 	if (arg >= NR_OPEN)
 		return -EMFILE;
-	current->close_on_exec &= ~(1<<arg);
-	(current->filp[arg] = current->filp[fd])->f_count++;
+	current->files->close_on_exec &= ~(1<<arg);
+	(current->files->fd[arg] = current->files->fd[fd])->f_count++;
 	return arg;
 }
 
@@ -48,18 +48,18 @@ int sys_fcntl(unsigned int fd, unsigned int cmd, unsigned long arg)
 {	
 	struct file * filp;
 
-	if (fd >= NR_OPEN || !(filp = current->filp[fd]))
+	if (fd >= NR_OPEN || !(filp = current->files->fd[fd]))
 		return -EBADF;
 	switch (cmd) {
 		case F_DUPFD:
 			return dupfd(fd,arg);
 		case F_GETFD:
-			return (current->close_on_exec>>fd)&1;
+			return (current->files->close_on_exec>>fd)&1;
 		case F_SETFD:
 			if (arg&1)
-				current->close_on_exec |= (1<<fd);
+				current->files->close_on_exec |= (1<<fd);
 			else
-				current->close_on_exec &= ~(1<<fd);
+				current->files->close_on_exec &= ~(1<<fd);
 			return 0;
 		case F_GETFL:
 			return filp->f_flags;
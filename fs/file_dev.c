@@ -6,14 +6,45 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/pagemap.h>
 #include <asm/segment.h>
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
+/*
+ * Regular files are read a page at a time through the page cache.
+ * Directories still come from the buffer cache, as namei.c changes
+ * them there without telling the page cache.
+ */
+static int cache_read(struct m_inode * inode, struct file * filp, char * buf, int count)
+{
+	int left,chars,nr;
+	unsigned long page;
+	char * p;
+
+	left = count;
+	while (left) {
+		nr = (filp->f_pos/PAGE_SIZE) * (PAGE_SIZE/BLOCK_SIZE);
+		if (!(page = read_cache_page(inode,nr)))
+			break;
+		nr = filp->f_pos % PAGE_SIZE;
+		chars = MIN( PAGE_SIZE-nr , left );
+		filp->f_pos += chars;
+		left -= chars;
+		p = nr + (char *) page;
+		while (chars-->0)
+			put_fs_byte(*(p++),buf++);
+		free_page(page);
+	}
+	inode->i_atime = CURRENT_TIME;
+	return (count-left)?(count-left):-ERROR;
+}
+
 int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 {
 	int left,chars,nr;
@@ -21,6 +52,8 @@ int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 
 	if ((left=count)<=0)
 		return 0;
+	if (S_ISREG(inode->i_mode))
+		return cache_read(inode,filp,buf,count);
 	while (left) {
 		if ((nr = bmap(inode,(filp->f_pos)/BLOCK_SIZE))) {
 			if (!(bh=bread(inode->i_dev,nr)))
@@ -48,7 +81,7 @@ int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 int file_write(struct m_inode * inode, struct file * filp, char * buf, int count)
 {
 	off_t pos;
-	int block,c;
+	int block,c,off;
 	struct buffer_head * bh;
 	char * p;
 	int i=0;
@@ -66,10 +99,11 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 			break;
 		if (!(bh=bread(inode->i_dev,block)))
 			break;
-		c = pos % BLOCK_SIZE;
-		p = c + bh->b_data;
+		block = pos/BLOCK_SIZE;
+		off = pos % BLOCK_SIZE;
+		p = off + bh->b_data;
 		bh->b_dirt = 1;
-		c = BLOCK_SIZE-c;
+		c = BLOCK_SIZE-off;
 		if (c > count-i) c = count-i;
 		pos += c;
 		if (pos > inode->i_size) {
@@ -79,6 +113,8 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 		i += c;
 		while (c-->0)
 			*(p++) = get_fs_byte(buf++);
+		update_page_cache(inode,block,off,off + bh->b_data,
+			p - off - bh->b_data);
 		brelse(bh);
 	}
 	inode->i_mtime = CURRENT_TIME;
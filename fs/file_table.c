@@ -4,6 +4,32 @@
  *  (C) 1991  Linus Torvalds
  */
 
+/*
+ * Open files come from an object cache, so there is no fixed table to
+ * run out of. get_empty_filp() returns one with f_count 1; whoever
+ * drops the last count gives it back with free_filp().
+ */
+
 #include <linux/fs.h>
+#include <linux/slab.h>
+
+static struct kmem_cache filp_cache = KMEM_CACHE("filp", struct file, NULL);
+
+struct file * get_empty_filp(void)
+{
+	struct file * f;
+
+	if (!(f = kmem_cache_alloc(&filp_cache)))
+		return NULL;
+	f->f_mode = 0;
+	f->f_flags = 0;
+	f->f_count = 1;
+	f->f_inode = NULL;
+	f->f_pos = 0;
+	return f;
+}
 
-struct file file_table[NR_FILE];
+void free_filp(struct file * f)
+{
+	kmem_cache_free(&filp_cache,f);
+}
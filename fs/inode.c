@@ -10,6 +10,7 @@
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/pagemap.h>
 #include <asm/system.h>
 
 struct m_inode inode_table[NR_INODE]={{0,},};
@@ -19,25 +20,17 @@ static void write_inode(struct m_inode * inode);
 
 static inline void wait_on_inode(struct m_inode * inode)
 {
-	cli();
-	while (inode->i_lock)
-		sleep_on(&inode->i_wait);
-	sti();
+	mutex_wait(&inode->i_lock);
 }
 
 static inline void lock_inode(struct m_inode * inode)
 {
-	cli();
-	while (inode->i_lock)
-		sleep_on(&inode->i_wait);
-	inode->i_lock=1;
-	sti();
+	mutex_lock(&inode->i_lock);
 }
 
 static inline void unlock_inode(struct m_inode * inode)
 {
-	inode->i_lock=0;
-	wake_up(&inode->i_wait);
+	mutex_unlock(&inode->i_lock);
 }
 
 void invalidate_inodes(int dev)
@@ -51,6 +44,7 @@ void invalidate_inodes(int dev)
 		if (inode->i_dev == dev) {
 			if (inode->i_count)
 				printk("inode in use on removed disk\n\r");
+			invalidate_inode_pages(inode);
 			inode->i_dev = inode->i_dirt = 0;
 		}
 	}
@@ -76,7 +70,7 @@ static int _bmap(struct m_inode * inode,int block,int create)
 
 	if (block<0)
 		panic("_bmap: block<0");
-	if (block >= 7+512+512*512)
+	if (block >= MAX_FILE_BLOCKS)
 		panic("_bmap: block>big");
 	if (block<7) {
 		if (create && !inode->i_zone[block])
@@ -204,7 +198,7 @@ struct m_inode * get_empty_inode(void)
 				last_inode = inode_table;
 			if (!last_inode->i_count) {
 				inode = last_inode;
-				if (!inode->i_dirt && !inode->i_lock)
+				if (!inode->i_dirt && !mutex_locked(&inode->i_lock))
 					break;
 			}
 		}
@@ -220,6 +214,7 @@ struct m_inode * get_empty_inode(void)
 			wait_on_inode(inode);
 		}
 	} while (inode->i_count);
+	invalidate_inode_pages(inode);
 	memset(inode,0,sizeof(*inode));
 	inode->i_count = 1;
 	return inode;
@@ -111,7 +111,7 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 /* check for '..', as we might have to do some "magic" for it */
 	if (namelen==2 && get_fs_byte(name)=='.' && get_fs_byte(name+1)=='.') {
 /* '..' in a pseudo-root results in a faked '.' (just change namelen) */
-		if ((*dir) == current->root)
+		if ((*dir) == current->fs->root)
 			namelen=1;
 		else if ((*dir)->i_num == ROOT_INO) {
 /* '..' over a mount-point results in 'dir' being exchanged for the mounted
@@ -234,15 +234,15 @@ static struct m_inode * get_dir(const char * pathname)
 	int namelen,inr,idev;
 	struct dir_entry * de;
 
-	if (!current->root || !current->root->i_count)
+	if (!current->fs->root || !current->fs->root->i_count)
 		panic("No root inode");
-	if (!current->pwd || !current->pwd->i_count)
+	if (!current->fs->pwd || !current->fs->pwd->i_count)
 		panic("No cwd inode");
 	if ((c=get_fs_byte(pathname))=='/') {
-		inode = current->root;
+		inode = current->fs->root;
 		pathname++;
 	} else if (c)
-		inode = current->pwd;
+		inode = current->fs->pwd;
 	else
 		return NULL;	/* empty name is bad */
 	inode->i_count++;
@@ -345,7 +345,7 @@ int open_namei(const char * pathname, int flag, int mode,
 
 	if ((flag & O_TRUNC) && !(flag & O_ACCMODE))
 		flag |= O_WRONLY;
-	mode &= 0777 & ~current->umask;
+	mode &= 0777 & ~current->fs->umask;
 	mode |= I_REGULAR;
 	if (!(dir = dir_namei(pathname,&namelen,&basename)))
 		return -ENOENT;
@@ -517,7 +517,7 @@ int sys_mkdir(const char * pathname, int mode)
 	inode->i_nlinks = 2;
 	dir_block->b_dirt = 1;
 	brelse(dir_block);
-	inode->i_mode = I_DIRECTORY | (mode & 0777 & ~current->umask);
+	inode->i_mode = I_DIRECTORY | (mode & 0777 & ~current->fs->umask);
 	inode->i_dirt = 1;
 	bh = add_entry(dir,basename,namelen,&de);
 	if (!bh) {
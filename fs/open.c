@@ -82,8 +82,8 @@ int sys_chdir(const char * filename)
 		iput(inode);
 		return -ENOTDIR;
 	}
-	iput(current->pwd);
-	current->pwd = inode;
+	iput(current->fs->pwd);
+	current->fs->pwd = inode;
 	return (0);
 }
 
@@ -97,8 +97,8 @@ int sys_chroot(const char * filename)
 		iput(inode);
 		return -ENOTDIR;
 	}
-	iput(current->root);
-	current->root = inode;
+	iput(current->fs->root);
+	current->fs->root = inode;
 	return (0);
 }
 
@@ -141,22 +141,19 @@ int sys_open(const char * filename,int flag,int mode)
 	struct file * f;
 	int i,fd;
 
-	mode &= 0777 & ~current->umask;
+	mode &= 0777 & ~current->fs->umask;
 	for(fd=0 ; fd<NR_OPEN ; fd++)
-		if (!current->filp[fd])
+		if (!current->files->fd[fd])
 			break;
 	if (fd>=NR_OPEN)
 		return -EINVAL;
-	current->close_on_exec &= ~(1<<fd);
-	f=0+file_table;
-	for (i=0 ; i<NR_FILE ; i++,f++)
-		if (!f->f_count) break;
-	if (i>=NR_FILE)
-		return -EINVAL;
-	(current->filp[fd]=f)->f_count++;
+	current->files->close_on_exec &= ~(1<<fd);
+	if (!(f=get_empty_filp()))
+		return -ENFILE;
+	current->files->fd[fd]=f;
 	if ((i=open_namei(filename,flag,mode,&inode))<0) {
-		current->filp[fd]=NULL;
-		f->f_count=0;
+		current->files->fd[fd]=NULL;
+		free_filp(f);
 		return i;
 	}
 /* ttys are somewhat special (ttyxx major==4, tty major==5) */
@@ -169,8 +166,8 @@ int sys_open(const char * filename,int flag,int mode)
 		} else if (MAJOR(inode->i_zone[0])==5)
 			if (current->tty<0) {
 				iput(inode);
-				current->filp[fd]=NULL;
-				f->f_count=0;
+				current->files->fd[fd]=NULL;
+				free_filp(f);
 				return -EPERM;
 			}
 	}
@@ -196,14 +193,15 @@ int sys_close(unsigned int fd)
 
 	if (fd >= NR_OPEN)
 		return -EINVAL;
-	current->close_on_exec &= ~(1<<fd);
-	if (!(filp = current->filp[fd]))
+	current->files->close_on_exec &= ~(1<<fd);
+	if (!(filp = current->files->fd[fd]))
 		return -EINVAL;
-	current->filp[fd] = NULL;
+	current->files->fd[fd] = NULL;
 	if (filp->f_count == 0)
 		panic("Close: file count is 0");
 	if (--filp->f_count)
 		return (0);
 	iput(filp->f_inode);
+	free_filp(filp);
 	return (0);
 }
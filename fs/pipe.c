@@ -5,9 +5,11 @@
  */
 
 #include <signal.h>
+#include <errno.h>
 
 #include <linux/sched.h>
 #include <linux/mm.h>	/* for get_free_page */
+#include <linux/kernel.h>	/* for verify_area */
 #include <asm/segment.h>
 
 int read_pipe(struct m_inode * inode, char * buf, int count)
@@ -75,30 +77,32 @@ int sys_pipe(unsigned long * fildes)
 	int fd[2];
 	int i,j;
 
-	j=0;
-	for(i=0;j<2 && i<NR_FILE;i++)
-		if (!file_table[i].f_count)
-			(f[j++]=i+file_table)->f_count++;
-	if (j==1)
-		f[0]->f_count=0;
-	if (j<2)
+	if (verify_area(fildes,8))
+		return -EFAULT;
+	if (!(f[0]=get_empty_filp()))
 		return -1;
+	if (!(f[1]=get_empty_filp())) {
+		free_filp(f[0]);
+		return -1;
+	}
 	j=0;
 	for(i=0;j<2 && i<NR_OPEN;i++)
-		if (!current->filp[i]) {
-			current->filp[ fd[j]=i ] = f[j];
+		if (!current->files->fd[i]) {
+			current->files->fd[ fd[j]=i ] = f[j];
 			j++;
 		}
 	if (j==1)
-		current->filp[fd[0]]=NULL;
+		current->files->fd[fd[0]]=NULL;
 	if (j<2) {
-		f[0]->f_count=f[1]->f_count=0;
+		free_filp(f[0]);
+		free_filp(f[1]);
 		return -1;
 	}
 	if (!(inode=get_pipe_inode())) {
-		current->filp[fd[0]] =
-			current->filp[fd[1]] = NULL;
-		f[0]->f_count = f[1]->f_count = 0;
+		current->files->fd[fd[0]] =
+			current->files->fd[fd[1]] = NULL;
+		free_filp(f[0]);
+		free_filp(f[1]);
 		return -1;
 	}
 	f[0]->f_inode = f[1]->f_inode = inode;
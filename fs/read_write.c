@@ -27,7 +27,7 @@ int sys_lseek(unsigned int fd,off_t offset, int origin)
 	struct file * file;
 	int tmp;
 
-	if (fd >= NR_OPEN || !(file=current->filp[fd]) || !(file->f_inode)
+	if (fd >= NR_OPEN || !(file=current->files->fd[fd]) || !(file->f_inode)
 	   || !IS_SEEKABLE(MAJOR(file->f_inode->i_dev)))
 		return -EBADF;
 	if (file->f_inode->i_pipe)
@@ -57,11 +57,12 @@ int sys_read(unsigned int fd,char * buf,int count)
 	struct file * file;
 	struct m_inode * inode;
 
-	if (fd>=NR_OPEN || count<0 || !(file=current->filp[fd]))
+	if (fd>=NR_OPEN || count<0 || !(file=current->files->fd[fd]))
 		return -EINVAL;
 	if (!count)
 		return 0;
-	verify_area(buf,count);
+	if (verify_area(buf,count))
+		return -EFAULT;
 	inode = file->f_inode;
 	if (inode->i_pipe)
 		return (file->f_mode&1)?read_pipe(inode,buf,count):-EIO;
@@ -85,7 +86,7 @@ int sys_write(unsigned int fd,char * buf,int count)
 	struct file * file;
 	struct m_inode * inode;
 	
-	if (fd>=NR_OPEN || count <0 || !(file=current->filp[fd]))
+	if (fd>=NR_OPEN || count <0 || !(file=current->files->fd[fd]))
 		return -EINVAL;
 	if (!count)
 		return 0;
@@ -30,27 +30,17 @@ int ROOT_DEV = 0;
 
 static void lock_super(struct super_block * sb)
 {
-	cli();
-	while (sb->s_lock)
-		sleep_on(&(sb->s_wait));
-	sb->s_lock = 1;
-	sti();
+	mutex_lock(&sb->s_lock);
 }
 
 static void free_super(struct super_block * sb)
 {
-	cli();
-	sb->s_lock = 0;
-	wake_up(&(sb->s_wait));
-	sti();
+	mutex_unlock(&sb->s_lock);
 }
 
 static void wait_on_super(struct super_block * sb)
 {
-	cli();
-	while (sb->s_lock)
-		sleep_on(&(sb->s_wait));
-	sti();
+	mutex_wait(&sb->s_lock);
 }
 
 struct super_block * get_super(int dev)
@@ -247,16 +237,13 @@ void mount_root(void)
 
 	if (32 != sizeof (struct d_inode))
 		panic("bad i-node size");
-	for(i=0;i<NR_FILE;i++)
-		file_table[i].f_count=0;
 	if (MAJOR(ROOT_DEV) == 2) {
 		printk("Insert root floppy and press ENTER");
 		wait_for_keypress();
 	}
 	for(p = &super_block[0] ; p < &super_block[NR_SUPER] ; p++) {
 		p->s_dev = 0;
-		p->s_lock = 0;
-		p->s_wait = NULL;
+		mutex_init(&p->s_lock);
 	}
 	if (!(p=read_super(ROOT_DEV)))
 		panic("Unable to mount root");
@@ -264,8 +251,8 @@ void mount_root(void)
 		panic("Unable to read root i-node");
 	mi->i_count += 3 ;	/* NOTE! it is logically used 4 times, not 1 */
 	p->s_isup = p->s_imount = mi;
-	current->pwd = mi;
-	current->root = mi;
+	current->fs->pwd = mi;
+	current->fs->root = mi;
 	free=0;
 	i=p->s_nzones;
 	while (-- i >= 0)
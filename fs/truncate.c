@@ -5,6 +5,7 @@
  */
 
 #include <linux/sched.h>
+#include <linux/pagemap.h>
 
 #include <sys/stat.h>
 
@@ -50,6 +51,7 @@ void truncate(struct m_inode * inode)
 
 	if (!(S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode)))
 		return;
+	invalidate_inode_pages(inode);
 	for (i=0;i<7;i++)
 		if (inode->i_zone[i]) {
 			free_block(inode->i_dev,inode->i_zone[i]);
@@ -0,0 +1,33 @@
+#ifndef _CPUFEATURE_H
+#define _CPUFEATURE_H
+
+/*
+ * Feature bits as returned in %edx by cpuid function 1. cpu_init()
+ * leaves x86_capability zero on processors without cpuid, so a test
+ * with cpu_has() is always safe.
+ */
+#define X86_FEATURE_FPU		(1<<0)
+#define X86_FEATURE_TSC		(1<<4)
+#define X86_FEATURE_SEP		(1<<11)	/* sysenter/sysexit */
+#define X86_FEATURE_FXSR	(1<<24)	/* fxsave/fxrstor */
+#define X86_FEATURE_SSE		(1<<25)
+
+extern int x86;				/* 3 = 386, 4 = 486, 5 = pentium ... */
+extern unsigned long x86_capability;
+
+#define cpu_has(feature) (x86_capability & (feature))
+
+#define rdtsc(low,high) \
+__asm__ __volatile__("rdtsc":"=a" (low),"=d" (high))
+
+#define MSR_SYSENTER_CS		0x174
+#define MSR_SYSENTER_ESP	0x175
+#define MSR_SYSENTER_EIP	0x176
+
+#define wrmsr(msr,low,high) \
+__asm__ __volatile__("wrmsr"::"c" (msr),"a" (low),"d" (high))
+
+extern void cpu_init(void);
+extern int sysenter_init(unsigned long esp, void (*entry)(void));
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef _BLKSTAT_H
+#define _BLKSTAT_H
+
+/*
+ * Block device statistics, kept by ll_rw_blk.c for every device
+ * (major and minor) that has seen a request, in at most NR_BLKSTAT
+ * slots. Times are in microseconds; the histograms are log2 buckets,
+ * bucket n counting intervals of [2^n, 2^(n+1)) us, the last one
+ * everything longer.
+ *
+ * Queue time runs from make_request() until the request reaches the
+ * head of its queue and the driver starts on it; service time from
+ * there until end_request(). The depth a new request sees on arrival
+ * is summed in depth_sum, so depth_sum/(ios[0]+ios[1]) is the mean.
+ *
+ *	blkstat(slot, buf)	copy one slot, returns its dev or -ENOENT
+ *	blkstat(-1, NULL)	clear all slots
+ */
+#define NR_BLKSTAT 16
+#define BLK_HIST 20
+
+struct blk_stat {
+	int dev;			/* -1 if unused */
+	unsigned long ios[2];		/* requests: READ, WRITE */
+	unsigned long sectors[2];
+	unsigned long errors;
+	unsigned long in_queue;		/* requests queued right now */
+	unsigned long max_queue;
+	unsigned long depth_sum;
+	unsigned long long busy;	/* time with a non-empty queue */
+	unsigned long busy_start;
+	unsigned long queue_hist[BLK_HIST];
+	unsigned long service_hist[BLK_HIST];
+};
+
+int blkstat(int slot, struct blk_stat * buf);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef _BUFSTAT_H
+#define _BUFSTAT_H
+
+/*
+ * Buffer-cache statistics, kept by fs/buffer.c.
+ *
+ *	bufstat(st, NULL, 0)	copy the counters to st
+ *	bufstat(NULL, buf, n)	copy up to n cached blocks to buf
+ *	bufstat((void *) -1, NULL, 0)	clear the counters
+ *
+ * Either pointer may be NULL. The number of blocks copied is returned;
+ * only buffers that hold a block (b_dev != 0) are listed.
+ */
+struct buffer_stat {
+	unsigned long nr_buffers;
+	unsigned long getblk_hits;	/* found in the hash table */
+	unsigned long getblk_misses;	/* had to take a free buffer */
+	unsigned long bread_hits;	/* bread() found the block uptodate */
+	unsigned long bread_waits;	/* bread() had to wait for the disk */
+	unsigned long evict_clean;	/* a cached block was dropped */
+	unsigned long evict_dirty;	/* ... after it had to be written */
+	unsigned long evict_syncs;	/* sync_dev() calls done by getblk() */
+	unsigned long buffer_waits;	/* sleeps on buffer_wait, none free */
+	unsigned long lock_waits;	/* sleeps in wait_on_buffer() */
+	unsigned long grown;		/* pages taken from get_free_page() */
+	unsigned long shrunk;		/* pages given back under pressure */
+};
+
+struct buffer_info {
+	unsigned short dev;
+	unsigned short count;
+	unsigned long block;
+	unsigned char uptodate;
+	unsigned char dirt;
+	unsigned char lock;
+	unsigned char unused;
+};
+
+#endif
@@ -18,6 +18,29 @@
 /*#define KBD_FR */
 /*#define KBD_FINNISH */
 
+/*
+ * Define SYSCALL_STATS to count the calls and rdtsc cycles of every
+ * system call, both kernel-wide and per task, readable with scstat().
+ * It needs a cpu with a TSC. Left undefined, it costs nothing.
+ */
+/* #define SYSCALL_STATS */
+
+/*
+ * Define LOCK_STATS to count, in every spinlock and mutex, how often it
+ * was found taken. Ctrl-ScrollLock prints the counts of the global locks.
+ */
+/* #define LOCK_STATS */
+
+/*
+ * The compressed ram disk (minor 2 of the ram disk, see
+ * kernel/blk_drv/zram.c) holds ZRAM_PAGES pages. Besides its block table
+ * it takes memory only for what has been written to it, and it comes up
+ * formatted as swap, so 'mknod /dev/zram b 1 2' and swapon("/dev/zram")
+ * is all it needs.
+ */
+#define ZRAM_DEV 0x0102
+#define ZRAM_PAGES 2048
+
 /*
  * Normally, Linux can get the drive parameters from the BIOS at
  * startup, but if this for some unfathomable reason fails, you'd
@@ -0,0 +1,26 @@
+#ifndef _DMESG_H
+#define _DMESG_H
+
+/*
+ * The kernel log, kept by kernel/printk.c: the last LOG_RECORDS pieces
+ * of printk() output, each with its sequence number and the time since
+ * boot it was logged at. A printk() longer than LOG_TEXT bytes takes
+ * several records, continuing each other.
+ *
+ *	dmesg(seq, buf)	copy record seq, or the oldest one left if seq
+ *			is older; returns the seq copied, or -ENOENT if
+ *			nothing at or after seq has been logged yet
+ *	dmesg(-1, NULL)	clear the log
+ */
+#define LOG_RECORDS 256		/* a power of two */
+#define LOG_TEXT 116
+
+struct log_record {
+	unsigned long seq;		/* in the ring seq+1, 0 while written */
+	unsigned long sec;
+	unsigned long usec;
+	unsigned short len;
+	char text[LOG_TEXT];
+};
+
+#endif
@@ -7,6 +7,7 @@
 #define _FS_H
 
 #include <sys/types.h>
+#include <linux/mutex.h>
 
 /* devices are as follows: (same as minix, so we can use the minix
  * file system. These are major numbers.)
@@ -42,12 +43,12 @@ void buffer_init(long buffer_end);
 
 #define NR_OPEN 20
 #define NR_INODE 32
-#define NR_FILE 64
 #define NR_SUPER 8
 #define NR_HASH 307
 #define NR_BUFFERS nr_buffers
 #define BLOCK_SIZE 1024
 #define BLOCK_SIZE_BITS 10
+#define MAX_FILE_BLOCKS (7+512+512*512)	/* direct, indirect, double */
 #ifndef NULL
 #define NULL ((void *) 0)
 #endif
@@ -72,8 +73,7 @@ struct buffer_head {
 	unsigned char b_uptodate;
 	unsigned char b_dirt;		/* 0-clean,1-dirty */
 	unsigned char b_count;		/* users using this block */
-	unsigned char b_lock;		/* 0 - ok, 1 -locked */
-	struct task_struct * b_wait;
+	struct mutex b_lock;		/* held while the block is read or written */
 	struct buffer_head * b_prev;
 	struct buffer_head * b_next;
 	struct buffer_head * b_prev_free;
@@ -105,12 +105,13 @@ struct m_inode {
 	unsigned short i_dev;
 	unsigned short i_num;
 	unsigned short i_count;
-	unsigned char i_lock;
+	struct mutex i_lock;
 	unsigned char i_dirt;
 	unsigned char i_pipe;
 	unsigned char i_mount;
 	unsigned char i_seek;
 	unsigned char i_update;
+	unsigned short i_pages;		/* pages in the page cache */
 };
 
 struct file {
@@ -137,8 +138,7 @@ struct super_block {
 	struct m_inode * s_isup;
 	struct m_inode * s_imount;
 	unsigned long s_time;
-	struct task_struct * s_wait;
-	unsigned char s_lock;
+	struct mutex s_lock;
 	unsigned char s_rd_only;
 	unsigned char s_dirt;
 };
@@ -160,7 +160,6 @@ struct dir_entry {
 };
 
 extern struct m_inode inode_table[NR_INODE];
-extern struct file file_table[NR_FILE];
 extern struct super_block super_block[NR_SUPER];
 extern struct buffer_head * start_buffer;
 extern int nr_buffers;
@@ -182,6 +181,8 @@ extern void iput(struct m_inode * inode);
 extern struct m_inode * iget(int dev,int nr);
 extern struct m_inode * get_empty_inode(void);
 extern struct m_inode * get_pipe_inode(void);
+extern struct file * get_empty_filp(void);
+extern void free_filp(struct file * f);
 extern struct buffer_head * get_hash_table(int dev, int block);
 extern struct buffer_head * getblk(int dev, int block);
 extern void ll_rw_block(int rw, struct buffer_head * bh);
@@ -189,6 +190,7 @@ extern void brelse(struct buffer_head * buf);
 extern struct buffer_head * bread(int dev,int block);
 extern void bread_page(unsigned long addr,int dev,int b[4]);
 extern struct buffer_head * breada(int dev,int block,...);
+extern int shrink_buffers(int pages);
 extern int new_block(int dev);
 extern void free_block(int dev, int block);
 extern struct m_inode * new_inode(int dev);
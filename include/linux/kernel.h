@@ -1,10 +1,11 @@
 /*
  * 'kernel.h' contains some often-used function prototypes etc
  */
-void verify_area(void * addr,int count);
+int verify_area(void * addr,int count);
 void panic(const char * str);
 int printf(const char * fmt, ...);
 int printk(const char * fmt, ...);
+void console_drain(void);
 int tty_write(unsigned ch,char * buf,int count);
 void * malloc(unsigned int size);
 void free_s(void * obj, int size);
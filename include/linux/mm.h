@@ -3,8 +3,90 @@
 
 #define PAGE_SIZE 4096
 
+/* these are not to be changed without changing head.s etc */
+#define LOW_MEM 0x100000
+#define PAGING_MEMORY (15*1024*1024)
+#define PAGING_PAGES (PAGING_MEMORY>>12)
+#define MAP_NR(addr) (((addr)-LOW_MEM)>>12)
+
+/* reference counts of the pages above LOW_MEM, 0 = free */
+extern unsigned char mem_map [ PAGING_PAGES ];
+
 extern unsigned long get_free_page(void);
 extern unsigned long put_page(unsigned long page,unsigned long address);
+extern unsigned long put_kernel_page(unsigned long page,unsigned long address);
 extern void free_page(unsigned long addr);
 
+extern unsigned long nr_free_pages;
+extern unsigned long nr_main_pages;
+
+/*
+ * invalidate() flushes the whole TLB, for changes to many page table
+ * entries at once. invalidate_page() drops just the one linear address
+ * (see mm/memory.c).
+ */
+#define invalidate() \
+__asm__("movl %%cr3,%%eax\n\tmovl %%eax,%%cr3":::"ax")
+
+extern void invalidate_page(unsigned long address);
+
+/*
+ * A page table entry of a page that is out on swap holds the swap slot
+ * shifted left by one, with the present bit clear. See mm/swap.c.
+ */
+#define SWP_ENTRY(nr) ((unsigned long) (nr) << 1)
+#define SWP_NR(entry) ((entry) >> 1)
+
+extern int swap_out(void);
+extern void swap_free(int nr);
+extern void swap_duplicate(int nr);
+extern void read_swap_page(int nr, char * buf);
+
+/*
+ * A task's mmap()ed areas, sorted by address. Addresses are relative
+ * to the start of the task's segment, like the user sees them. Areas
+ * are placed between MMAP_BASE and MMAP_END, above the heap and well
+ * below the stack. See mm/mmap.c.
+ */
+#define MMAP_BASE 0x10000000
+#define MMAP_END 0x30000000
+
+struct m_inode;
+struct task_struct;
+
+struct vm_area_struct {
+	unsigned long vm_start;
+	unsigned long vm_end;
+	unsigned short vm_flags;	/* MAP_SHARED or MAP_PRIVATE */
+	unsigned short vm_prot;
+	struct m_inode * vm_inode;	/* NULL for anonymous memory */
+	unsigned long vm_offset;	/* file offset of vm_start */
+	struct vm_area_struct * vm_next;
+};
+
+/*
+ * The address space of a task: its page directory, mmap()ed areas and
+ * break. Tasks made by clone(CLONE_VM) share one. 'users' counts the
+ * tasks running in it, and the last of them to exit frees the pages;
+ * 'count' counts zombies too, as they still run on the page directory
+ * until release() frees it.
+ */
+struct mm_struct {
+	int users;
+	int count;
+	unsigned long pg_dir;
+	unsigned long brk;
+	struct vm_area_struct * mmap;
+};
+
+extern struct vm_area_struct * find_vma(struct task_struct * task,
+	unsigned long addr);
+extern void zap_pages(struct task_struct * task, struct vm_area_struct * area,
+	unsigned long start, unsigned long end);
+extern int copy_mmap(struct task_struct * p);
+extern void exit_mmap(struct task_struct * p);
+extern struct mm_struct * mm_alloc(void);
+extern void mmput(struct mm_struct * mm);
+extern void exit_mm(void);
+
 #endif
@@ -0,0 +1,54 @@
+#ifndef _MUTEX_H
+#define _MUTEX_H
+
+/*
+ * Sleeping locks, for the buffer, inode and super block locks. Taking a
+ * free mutex is one xchg with interrupts left on. Only when it is taken
+ * are interrupts turned off, from the test until sleep_on(), as the
+ * holder may be an interrupt handler about to call mutex_unlock():
+ * buffers are unlocked by end_request().
+ */
+
+#include <linux/config.h>
+
+struct task_struct;
+
+struct mutex {
+	volatile unsigned char locked;
+	struct task_struct * wait;
+#ifdef LOCK_STATS
+	unsigned long contended;	/* times someone had to sleep */
+#endif
+};
+
+static inline int mutex_trylock(struct mutex * m)
+{
+	unsigned char old = 1;
+
+	__asm__ __volatile__("xchgb %0,%1"
+		:"=q" (old),"=m" (m->locked)
+		:"0" (old):"memory");
+	return !old;
+}
+
+#define mutex_locked(m) ((m)->locked)
+
+extern void __mutex_lock(struct mutex * m);
+extern void __mutex_wait(struct mutex * m);
+extern void mutex_unlock(struct mutex * m);
+extern void mutex_init(struct mutex * m);
+
+static inline void mutex_lock(struct mutex * m)
+{
+	if (!mutex_trylock(m))
+		__mutex_lock(m);
+}
+
+/* wait until the mutex is free, without taking it */
+static inline void mutex_wait(struct mutex * m)
+{
+	if (m->locked)
+		__mutex_wait(m);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _PAGEMAP_H
+#define _PAGEMAP_H
+
+/*
+ * The page cache keeps whole pages of file data, found by the in-core
+ * inode and the first logical block of the page (see mm/filemap.c).
+ */
+#include <linux/fs.h>
+
+struct cache_page {
+	struct m_inode * inode;
+	unsigned long block;
+	unsigned long page;		/* 0 if the entry is free */
+	struct cache_page * next;	/* hash chain, or the free list */
+	unsigned char referenced;
+};
+
+extern unsigned long read_cache_page(struct m_inode * inode, int block);
+extern unsigned long read_shared_page(struct m_inode * inode, int block);
+extern unsigned long try_cache_page(struct m_inode * inode, int block);
+extern void readahead_cache_page(struct m_inode * inode, int block);
+extern void update_page_cache(struct m_inode * inode, int block,
+	int offset, char * data, int count);
+extern void write_cache_page(struct m_inode * inode, int block,
+	unsigned long page);
+extern void invalidate_inode_pages(struct m_inode * inode);
+extern int shrink_page_cache(int pages);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _PROF_H
+#define _PROF_H
+
+/*
+ * Commands for the prof() system call. The profiler is kernel-wide:
+ * on every timer tick do_timer() counts the interrupted eip in one of
+ * two histograms, one over the kernel text and one over the first
+ * 'user_span' bytes of user code space. Each bucket covers 1<<shift
+ * bytes of code.
+ *
+ *	prof(PROF_START, shift, user_span)	allocate, clear and start
+ *	prof(PROF_STOP, 0, 0)			stop sampling, keep the data
+ *	prof(PROF_READ, buf, size)		copy header and buckets out
+ *	prof(PROF_FREE, 0, 0)			stop and release the buffers
+ *
+ * PROF_READ returns the number of bytes copied: a struct prof_header
+ * followed by kernel_buckets and then user_buckets counters.
+ */
+#define PROF_START	0
+#define PROF_STOP	1
+#define PROF_READ	2
+#define PROF_FREE	3
+
+#define PROF_MAX_PAGES	32	/* 32k buckets, kernel and user together */
+
+struct prof_header {
+	unsigned long shift;
+	unsigned long kernel_buckets;
+	unsigned long user_buckets;
+	unsigned long kernel_ticks;
+	unsigned long user_ticks;
+	unsigned long lost_ticks;	/* user eip beyond user_span */
+};
+
+#endif
@@ -1,12 +1,22 @@
 #ifndef _SCHED_H
 #define _SCHED_H
 
-#define NR_TASKS 64
+/*
+ * Every task but task 0 has a page directory of its own, and its
+ * segments all start at TASK_BASE, so the number of tasks is no longer
+ * bound by the 4GB of linear space. NR_TASKS is only limited by the
+ * gdt in boot/head.s, which has two entries for each task.
+ */
+#define NR_TASKS 256
 #define HZ 100
 
+#define TASK_BASE 0x40000000
+#define TASK_SIZE 0x40000000
+
 #define FIRST_TASK task[0]
 #define LAST_TASK task[NR_TASKS-1]
 
+#include <linux/config.h>
 #include <linux/head.h>
 #include <linux/fs.h>
 #include <linux/mm.h>
@@ -16,6 +26,32 @@
 #error "Currently the close-on-exec-flags are in one word, max 32 files/proc"
 #endif
 
+/*
+ * The open files and the fs info (cwd, root, umask) of a task. Tasks
+ * made by clone() with CLONE_FILES or CLONE_FS share them; 'count' is
+ * the number of tasks using one.
+ */
+struct files_struct {
+	int count;
+	unsigned long close_on_exec;
+	struct file * fd[NR_OPEN];
+};
+
+struct fs_struct {
+	int count;
+	unsigned short umask;
+	struct m_inode * pwd;
+	struct m_inode * root;
+};
+
+#define INIT_FILES { 1, 0, {NULL,} }
+#define INIT_FS { 1, 0022, NULL, NULL }
+
+/* clone() flags: what the new task shares instead of copying */
+#define CLONE_VM	0x00000100
+#define CLONE_FS	0x00000200
+#define CLONE_FILES	0x00000400
+
 #define TASK_RUNNING		0
 #define TASK_INTERRUPTIBLE	1
 #define TASK_UNINTERRUPTIBLE	2
@@ -26,8 +62,11 @@
 #define NULL ((void *) 0)
 #endif
 
-extern int copy_page_tables(unsigned long from, unsigned long to, long size);
-extern int free_page_tables(unsigned long from, unsigned long size);
+extern int copy_page_tables(unsigned long * from_dir, unsigned long from,
+	unsigned long * to_dir, unsigned long to, long size);
+extern int free_page_tables(unsigned long * dir, unsigned long from,
+	unsigned long size);
+extern unsigned long * new_page_dir(void);
 
 extern void sched_init(void);
 extern void schedule(void);
@@ -50,6 +89,29 @@ struct i387_struct {
 	long	st_space[20];	/* 8*10 bytes for each FP-reg = 80 bytes */
 };
 
+/* the 512 byte area of fxsave, which holds the SSE registers too */
+struct i387_fxsave_struct {
+	unsigned short	cwd;
+	unsigned short	swd;
+	unsigned short	twd;
+	unsigned short	fop;
+	long	fip;
+	long	fcs;
+	long	foo;
+	long	fos;
+	long	mxcsr;
+	long	mxcsr_mask;
+	long	st_space[32];	/* 8*16 bytes for each FP-reg = 128 bytes */
+	long	xmm_space[32];	/* 8*16 bytes for each XMM-reg = 128 bytes */
+	long	padding[56];
+} __attribute__((aligned(16)));
+
+/* fnsave or fxsave, see math_state_restore() */
+union i387_union {
+	struct i387_struct soft;
+	struct i387_fxsave_struct fx;
+};
+
 struct tss_struct {
 	long	back_link;	/* 16 high bits zero */
 	long	esp0;
@@ -74,7 +136,7 @@ struct tss_struct {
 	long	gs;		/* 16 high bits zero */
 	long	ldt;		/* 16 high bits zero */
 	long	trace_bitmap;	/* bits: trace 0, bitmap 16-31 */
-	struct i387_struct i387;
+	union i387_union i387;
 };
 
 struct task_struct {
@@ -87,7 +149,7 @@ struct task_struct {
 	long blocked;	/* bitmap of masked signals */
 /* various fields */
 	int exit_code;
-	unsigned long start_code,end_code,end_data,brk,start_stack;
+	unsigned long start_code,end_code,end_data,start_stack;
 	long pid,father,pgrp,session,leader;
 	unsigned short uid,euid,suid;
 	unsigned short gid,egid,sgid;
@@ -96,16 +158,24 @@ struct task_struct {
 	unsigned short used_math;
 /* file system info */
 	int tty;		/* -1 if no tty, so it must be signed */
-	unsigned short umask;
-	struct m_inode * pwd;
-	struct m_inode * root;
+	struct fs_struct * fs;
 	struct m_inode * executable;
-	unsigned long close_on_exec;
-	struct file * filp[NR_OPEN];
+	struct files_struct * files;
+	struct mm_struct * mm;
 /* ldt for this task 0 - zero 1 - cs 2 - ds&ss */
 	struct desc_struct ldt[3];
 /* tss for this task */
 	struct tss_struct tss;
+#ifdef SYSCALL_STATS
+/* system call accounting, see kernel/scstat.c */
+	long sc_nr;
+	unsigned long long sc_start;
+	struct syscall_stat * sc_stat;
+#endif
+/* pid, pgrp and session hash chains, see kernel/pid.c */
+	struct task_struct * pid_next[3], ** pid_pprev[3];
+/* parent, youngest child, younger and older sibling */
+	struct task_struct * p_pptr, * p_cptr, * p_ysptr, * p_osptr;
 };
 
 /*
@@ -115,13 +185,12 @@ struct task_struct {
 #define INIT_TASK \
 /* state etc */	{ 0,15,15, \
 /* signals */	0,{{},},0, \
-/* ec,brk... */	0,0,0,0,0,0, \
+/* ec,brk... */	0,0,0,0,0, \
 /* pid etc.. */	0,-1,0,0,0, \
 /* uid etc */	0,0,0,0,0,0, \
 /* alarm */	0,0,0,0,0,0, \
 /* math */	0, \
-/* fs info */	-1,0022,NULL,NULL,NULL,0, \
-/* filp */	{NULL,}, \
+/* fs info */	-1,&init_fs,NULL,&init_files,&init_mm, \
 	{ \
 		{0,0}, \
 /* ldt */	{0x9f,0xc0fa00}, \
@@ -135,14 +204,61 @@ struct task_struct {
 	}, \
 }
 
+/*
+ * The page directory of a task is the one switch_to() loads into cr3. The
+ * kernel maps all of physical memory at the same address, so it can
+ * walk the tables of any task.
+ */
+#define task_pg_dir(p) ((unsigned long *) (p)->tss.cr3)
+#define pg_dir_entry(dir,address) ((dir) + ((address) >> 22))
+
 extern struct task_struct *task[NR_TASKS];
+extern struct mm_struct init_mm;
+extern struct fs_struct init_fs;
+extern struct files_struct init_files;
+
+/* the caches fork() takes them from, see <linux/slab.h> */
+struct kmem_cache;
+extern struct kmem_cache mm_cache, files_cache, fs_cache;
+
+/*
+ * Tasks are hashed on their pid, process group and session, so the
+ * tasks with one id are found without looking at all the others. A
+ * chain also holds tasks whose ids merely hash alike: for_each_task_pid()
+ * skips those. Task 0 is in none of them.
+ */
+#define PIDTYPE_PID	0
+#define PIDTYPE_PGID	1
+#define PIDTYPE_SID	2
+
+#define PIDHASH_SZ 64
+#define pid_hashfn(nr) ((nr) & (PIDHASH_SZ-1))
+
+extern struct task_struct * pid_hash[3][PIDHASH_SZ];
+
+#define task_pid_nr(p,type) ((type) == PIDTYPE_PID ? (p)->pid : \
+	(type) == PIDTYPE_PGID ? (p)->pgrp : (p)->session)
+
+#define for_each_task_pid(nr,type,p) \
+	for ((p) = pid_hash[type][pid_hashfn(nr)] ; (p) ; \
+	     (p) = (p)->pid_next[type]) \
+		if (task_pid_nr((p),(type)) == (nr))
+
+extern struct task_struct * find_task_by_pid(long pid);
+extern void change_pid(struct task_struct * p, int type, long nr);
+extern void link_task(struct task_struct * p);
+extern void unlink_task(struct task_struct * p);
+extern void reparent_children(struct task_struct * p);
 extern struct task_struct *last_task_used_math;
+extern void save_math_state(struct task_struct * p);
 extern struct task_struct *current;
 extern long volatile jiffies;
 extern long startup_time;
 
 #define CURRENT_TIME (startup_time+jiffies/HZ)
 
+extern unsigned long usec_clock(void);
+
 extern void add_timer(long jiffies, void (*fn)(void));
 extern void sleep_on(struct task_struct ** p);
 extern void interruptible_sleep_on(struct task_struct ** p);
@@ -150,7 +266,8 @@ extern void wake_up(struct task_struct ** p);
 
 /*
  * Entry into gdt where to find first TSS. 0-nul, 1-cs, 2-ds, 3-syscall
- * 4-TSS0, 5-LDT0, 6-TSS1 etc ...
+ * 4-TSS0, 5-LDT0, 6-TSS1 etc ... The LDT slots belong to the tasks, the
+ * TSS slots to the cpus: TSSn is the one tss of cpu n, see switch_to().
  */
 #define FIRST_TSS_ENTRY 4
 #define FIRST_LDT_ENTRY (FIRST_TSS_ENTRY+1)
@@ -158,31 +275,51 @@ extern void wake_up(struct task_struct ** p);
 #define _LDT(n) ((((unsigned long) n)<<4)+(FIRST_LDT_ENTRY<<3))
 #define ltr(n) __asm__("ltr %%ax"::"a" (_TSS(n)))
 #define lldt(n) __asm__("lldt %%ax"::"a" (_LDT(n)))
-#define str(n) \
-__asm__("str %%ax\n\t" \
-	"subl %2,%%eax\n\t" \
-	"shrl $4,%%eax" \
-	:"=a" (n) \
-	:"a" (0),"i" (FIRST_TSS_ENTRY<<3))
+
+extern struct tss_struct cpu_tss[];
+
+/*
+ * sysenter lands with %esp pointing at 'esp0' here, a copy of esp0 in
+ * the tss. The words below it take a debug trap or nmi that comes
+ * before sysenter_entry has switched stacks, see debug and nmi in asm.s.
+ */
+struct sysenter_stack {
+	long stack[8];
+	long esp0;
+};
+
+extern struct sysenter_stack sysenter_stack[];
+
 /*
  *	switch_to(n) should switch tasks to task nr n, first
  * checking that n isn't the current task, in which case it does nothing.
- * This also clears the TS-flag if the task we switched to has used
- * tha math co-processor latest.
+ *
+ * The switch is done in software: only eflags and %ebp are pushed, as
+ * the rest is clobbered anyway, and the stack pointer and resume address
+ * are kept in the tss of the task. __switch_to() in sched.c does the
+ * rest, and returns into the new task. The cpu's tss only provides
+ * esp0 for the next trap from user mode.
  */
 #define switch_to(n) {\
-struct {long a,b;} __tmp; \
-__asm__("cmpl %%ecx,current\n\t" \
+long __d; \
+__asm__ __volatile__("cmpl %%edx,current\n\t" \
 	"je 1f\n\t" \
-	"movw %%dx,%1\n\t" \
-	"xchgl %%ecx,current\n\t" \
-	"ljmp *%0\n\t" \
-	"cmpl %%ecx,last_task_used_math\n\t" \
-	"jne 1f\n\t" \
-	"clts\n" \
+	"movl current,%%eax\n\t" \
+	"pushfl\n\t" \
+	"pushl %%ebp\n\t" \
+	"movl %%esp,%c2(%%eax)\n\t" \
+	"movl $2f,%c3(%%eax)\n\t" \
+	"movl %c2(%%edx),%%esp\n\t" \
+	"pushl %c3(%%edx)\n\t" \
+	"jmp __switch_to\n" \
+	"2:\tpopl %%ebp\n\t" \
+	"popfl\n" \
 	"1:" \
-	::"m" (*&__tmp.a),"m" (*&__tmp.b), \
-	"d" (_TSS(n)),"c" ((long) task[n])); \
+	:"=d" (__d) \
+	:"0" ((long) task[n]), \
+	"i" (&((struct task_struct *) 0)->tss.esp), \
+	"i" (&((struct task_struct *) 0)->tss.eip) \
+	:"ax","bx","cx","si","di","memory"); \
 }
 
 #define PAGE_ALIGN(n) (((n)+0xfff)&0xfffff000)
@@ -0,0 +1,24 @@
+#ifndef _SCSTAT_H
+#define _SCSTAT_H
+
+/*
+ * System call accounting, see SYSCALL_STATS in <linux/config.h>.
+ * Cycles are measured with rdtsc from entry to exit of the call, so
+ * calls that sleep include the time they slept.
+ *
+ *	scstat(0, buf, n)	kernel-wide statistics
+ *	scstat(pid, buf, n)	statistics of one task
+ *	scstat(-1, NULL, 0)	clear the kernel-wide statistics
+ *
+ * buf gets one struct syscall_stat per system call number, at most n
+ * of them; the number of entries copied is returned.
+ */
+#define NR_SYSCALLS 128	/* room for all of sys_call_table */
+
+struct syscall_stat {
+	unsigned long count;
+	unsigned long long cycles;
+	unsigned long long max;
+};
+
+#endif
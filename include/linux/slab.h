@@ -0,0 +1,46 @@
+#ifndef _SLAB_H
+#define _SLAB_H
+
+/*
+ * Object caches, see mm/slab.c. A cache hands out objects of one size
+ * from pages of its own, so freeing needs no size, and a page goes back
+ * to get_free_page() once all its objects are free again.
+ *
+ * Caches are static, declared with KMEM_CACHE(); the rest is set up on
+ * the first allocation. The constructor, if any, runs once per object
+ * when a page is added to the cache, and objects must be freed in their
+ * constructed state. New pages are zeroed, so a cache without one hands
+ * out zeroed objects until they are reused.
+ */
+
+#include <linux/spinlock.h>
+
+struct slab;
+
+struct kmem_cache {
+	char * name;
+	int size;
+	void (*ctor)(void * obj);
+/* the rest is set up on first use */
+	int objsize;			/* size rounded up */
+	int num;			/* objects per page */
+	int offset;			/* of the first object in the page */
+	struct slab * partial;		/* pages with used and free objects */
+	struct slab * empty;		/* at most one page kept all free */
+	spinlock_t lock;
+	struct kmem_cache * next;
+	unsigned long active;		/* objects handed out */
+	unsigned long allocs;
+	unsigned long frees;
+	unsigned long pages;
+	unsigned long grown;
+	unsigned long shrunk;
+};
+
+#define KMEM_CACHE(name,type,ctor) { (name), sizeof (type), (ctor) }
+
+extern void * kmem_cache_alloc(struct kmem_cache * cache);
+extern void kmem_cache_free(struct kmem_cache * cache, void * obj);
+extern int kmem_cache_reap(int pages);
+
+#endif
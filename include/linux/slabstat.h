@@ -0,0 +1,23 @@
+#ifndef _SLABSTAT_H
+#define _SLABSTAT_H
+
+/*
+ * Object cache statistics, kept by mm/slab.c for every cache that has
+ * been used, in the order they were first used.
+ *
+ *	slabstat(nr, buf)	copy cache nr, returns 0 or -ENOENT past
+ *				the last one
+ */
+struct slab_stat {
+	char name[16];
+	unsigned long size;		/* of an object, rounded up */
+	unsigned long num;		/* objects per page */
+	unsigned long active;		/* objects in use */
+	unsigned long allocs;
+	unsigned long frees;
+	unsigned long pages;		/* pages held now */
+	unsigned long grown;		/* pages taken from get_free_page() */
+	unsigned long shrunk;		/* pages given back */
+};
+
+#endif
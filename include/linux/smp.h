@@ -0,0 +1,10 @@
+#ifndef _SMP_H
+#define _SMP_H
+
+/*
+ * Only the boot processor runs the kernel. The per-cpu tables (the
+ * tss, the sysenter stack) are sized by NR_CPUS all the same.
+ */
+#define NR_CPUS 1
+
+#endif
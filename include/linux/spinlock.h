@@ -0,0 +1,65 @@
+#ifndef _SPINLOCK_H
+#define _SPINLOCK_H
+
+/*
+ * Spinlocks guard data that is only held for a few instructions and
+ * never across a sleep. Data that interrupt handlers touch too has to be
+ * locked with spin_lock_irqsave(), so that an interrupt on this cpu
+ * can't spin on a lock its own process holds. Anything else uses plain
+ * spin_lock() and keeps interrupts on.
+ *
+ * Locks that are held across a sleep are mutexes, see <linux/mutex.h>.
+ */
+
+#include <linux/config.h>
+#include <asm/system.h>
+
+typedef struct {
+	volatile unsigned long lock;
+#ifdef LOCK_STATS
+	unsigned long contended;	/* times it was found taken */
+#endif
+} spinlock_t;
+
+#ifdef LOCK_STATS
+#define SPIN_LOCK_UNLOCKED { 0, 0 }
+#define spin_contended(l) ((l)->contended++)
+#else
+#define SPIN_LOCK_UNLOCKED { 0 }
+#define spin_contended(l) do { } while (0)
+#endif
+
+static inline int spin_trylock(spinlock_t * l)
+{
+	unsigned long old = 1;
+
+	__asm__ __volatile__("xchgl %0,%1"
+		:"=r" (old),"=m" (l->lock)
+		:"0" (old):"memory");
+	return !old;
+}
+
+static inline void spin_lock(spinlock_t * l)
+{
+	if (spin_trylock(l))
+		return;
+	spin_contended(l);
+	do {
+		while (l->lock)
+			__asm__ __volatile__("rep ; nop");	/* pause */
+	} while (!spin_trylock(l));
+}
+
+static inline void spin_unlock(spinlock_t * l)
+{
+	__asm__ __volatile__("":::"memory");
+	l->lock = 0;
+}
+
+#define spin_lock_irqsave(l,flags) \
+do { save_flags(flags); cli(); spin_lock(l); } while (0)
+
+#define spin_unlock_irqrestore(l,flags) \
+do { spin_unlock(l); restore_flags(flags); } while (0)
+
+#endif
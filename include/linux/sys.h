@@ -72,6 +72,18 @@ extern int sys_setreuid();
 extern int sys_setregid();
 extern int sys_iam();
 extern int sys_whoami();
+extern int sys_gettimeofday();
+extern int sys_clock_gettime();
+extern int sys_scstat();
+extern int sys_blkstat();
+extern int sys_bufstat();
+extern int sys_mmap();
+extern int sys_munmap();
+extern int sys_swapon();
+extern int sys_faultaround();
+extern int sys_slabstat();
+extern int sys_dmesg();
+extern int sys_clone();
 
 fn_ptr sys_call_table[] = { sys_setup, sys_exit, sys_fork, sys_read,
 sys_write, sys_open, sys_close, sys_waitpid, sys_creat, sys_link,
@@ -85,4 +97,7 @@ sys_getgid, sys_signal, sys_geteuid, sys_getegid, sys_acct, sys_phys,
 sys_lock, sys_ioctl, sys_fcntl, sys_mpx, sys_setpgid, sys_ulimit,
 sys_uname, sys_umask, sys_chroot, sys_ustat, sys_dup2, sys_getppid,
 sys_getpgrp, sys_setsid, sys_sigaction, sys_sgetmask, sys_ssetmask,
-sys_setreuid,sys_setregid, sys_iam, sys_whoami };
+sys_setreuid,sys_setregid, sys_iam, sys_whoami, sys_gettimeofday,
+sys_clock_gettime, sys_scstat, sys_blkstat,
+sys_bufstat, sys_mmap, sys_munmap, sys_swapon, sys_faultaround,
+sys_slabstat, sys_dmesg, sys_clone };
@@ -0,0 +1,69 @@
+#ifndef _TIMEPAGE_H
+#define _TIMEPAGE_H
+
+#include <sys/time.h>
+
+/*
+ * The time page is a page of kernel memory that do_timer() updates on
+ * every tick, and that execve() maps read-only at TIME_PAGE_ADDR in the
+ * data segment of every process. Together with the TSC this lets user
+ * code read the time with microsecond resolution without a system call.
+ *
+ * The kernel makes 'seq' odd while it updates the page: readers retry
+ * if it was odd or changed under them. 'sysenter' tells the system call
+ * stubs in <unistd.h> that they may use sysenter instead of int 0x80.
+ */
+#define TIME_PAGE_ADDR 0x3ffff000	/* last page of the 1GB task space */
+
+struct time_page {
+	unsigned long seq;
+	long startup_time;
+	long jiffies;
+	long hz;
+	long usec_per_tick;
+	unsigned long tick_tsc;		/* low word of the TSC at the last tick */
+	unsigned long tsc_quotient;	/* 2^32*usec_per_tick/tsc_per_tick, 0 = no TSC */
+	long sysenter;
+};
+
+/*
+ * time_page_read() returns -1 if the TSC can't be used, in which case
+ * the caller has to ask the kernel. 'realtime' selects the epoch:
+ * 1970 for gettimeofday(), boot for CLOCK_MONOTONIC.
+ */
+static inline int time_page_read(volatile struct time_page * tp,
+	struct timeval * tv, int realtime)
+{
+	unsigned long seq, lo, hi, usec;
+	long ticks, sec;
+
+	if (!tp->tsc_quotient)
+		return -1;
+	do {
+		seq = tp->seq;
+		__asm__ __volatile__("":::"memory");
+		ticks = tp->jiffies;
+		sec = realtime ? tp->startup_time : 0;
+		__asm__ __volatile__("rdtsc":"=a" (lo),"=d" (hi));
+		lo -= tp->tick_tsc;
+		__asm__("mull %2"
+			:"=d" (usec),"=a" (lo)
+			:"rm" (tp->tsc_quotient),"1" (lo));
+		__asm__ __volatile__("":::"memory");
+	} while ((seq & 1) || seq != tp->seq);
+	if (usec >= tp->usec_per_tick)
+		usec = tp->usec_per_tick - 1;
+	tv->tv_sec = sec + ticks / tp->hz;
+	tv->tv_usec = usec + (ticks % tp->hz) * tp->usec_per_tick;
+	return 0;
+}
+
+/* the kernel keeps it in a page of its own, as it is visible to users */
+union time_page_union {
+	struct time_page p;
+	char page[4096];
+};
+
+extern union time_page_union time_page;
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _SYS_MMAN_H
+#define _SYS_MMAN_H
+
+#include <sys/types.h>
+
+#define PROT_NONE	0
+#define PROT_READ	1
+#define PROT_WRITE	2
+#define PROT_EXEC	4
+
+#define MAP_SHARED	1	/* writes go back to the file */
+#define MAP_PRIVATE	2	/* writes are copy-on-write */
+#define MAP_FIXED	0x10	/* use addr exactly */
+#define MAP_ANONYMOUS	0x20	/* zero-filled memory, fd is ignored */
+#define MAP_ANON	MAP_ANONYMOUS
+
+#define MAP_FAILED	((void *) -1)
+
+/*
+ * Pages can't be made unreadable on a 386, so PROT_NONE and PROT_EXEC
+ * mappings are readable. 'offset' has to be a multiple of the page size.
+ * A MAP_SHARED|MAP_ANONYMOUS area is shared with children only for the
+ * pages that had been touched before the fork().
+ */
+void * mmap(void * addr, size_t len, int prot, int flags, int fd, off_t offset);
+int munmap(void * addr, size_t len);
+
+#endif
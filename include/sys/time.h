@@ -0,0 +1,16 @@
+#ifndef _SYS_TIME_H
+#define _SYS_TIME_H
+
+struct timeval {
+	long	tv_sec;		/* seconds */
+	long	tv_usec;	/* microseconds */
+};
+
+struct timezone {
+	int	tz_minuteswest;	/* minutes west of Greenwich */
+	int	tz_dsttime;	/* type of dst correction */
+};
+
+int gettimeofday(struct timeval * tv, struct timezone * tz);
+
+#endif
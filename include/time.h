@@ -15,6 +15,16 @@ typedef unsigned int size_t;
 
 typedef long clock_t;
 
+typedef int clockid_t;
+
+#define CLOCK_REALTIME	0
+#define CLOCK_MONOTONIC	1
+
+struct timespec {
+	time_t	tv_sec;		/* seconds */
+	long	tv_nsec;	/* nanoseconds */
+};
+
 struct tm {
 	int tm_sec;
 	int tm_min;
@@ -38,5 +48,6 @@ struct tm * gmtime(const time_t *tp);
 struct tm *localtime(const time_t * tp);
 size_t strftime(char * s, size_t smax, const char * fmt, const struct tm * tp);
 void tzset(void);
+int clock_gettime(clockid_t clk, struct timespec * tp);
 
 #endif
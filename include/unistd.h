@@ -131,14 +131,55 @@
 #define __NR_setregid	71
 #define __NR_iam		72
 #define __NR_whoami		73
+#define __NR_gettimeofday	74
+#define __NR_clock_gettime	75
+#define __NR_scstat		76
+#define __NR_blkstat		77
+#define __NR_bufstat		78
+#define __NR_mmap		79
+#define __NR_munmap		80
+#define __NR_swapon		81
+#define __NR_faultaround	82
+#define __NR_slabstat		83
+#define __NR_dmesg		84
+#define __NR_clone		85
+
+/*
+ * A process that went through execve() has the time page, which says
+ * whether the kernel takes system calls through sysenter. The stub then
+ * leaves its stack pointer in %ebp, with the return address on top, and
+ * the kernel returns to it with iret as for int 0x80. Code that runs
+ * before the first execve() (init/main.c and lib/) has no time page and
+ * is compiled with NO_SYSENTER.
+ */
+#ifdef NO_SYSENTER
+#define __sysenter_ok() 0
+#define __SYSENTER "int $0x80"
+#else
+#include <linux/timepage.h>
+#define __sysenter_ok() \
+	(((volatile struct time_page *) TIME_PAGE_ADDR)->sysenter)
+#define __SYSENTER \
+	"pushl %%ebp\n\t" \
+	"pushl $1f\n\t" \
+	"movl %%esp,%%ebp\n\t" \
+	"sysenter\n" \
+	"1:\tpopl %%ebp"
+#endif
 
 #define _syscall0(type,name) \
   type name(void) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
-	: "=a" (__res) \
-	: "0" (__NR_##name)); \
+if (__sysenter_ok()) \
+	__asm__ volatile (__SYSENTER \
+		: "=a" (__res) \
+		: "0" (__NR_##name) \
+		: "memory"); \
+else \
+	__asm__ volatile ("int $0x80" \
+		: "=a" (__res) \
+		: "0" (__NR_##name)); \
 if (__res >= 0) \
 	return (type) __res; \
 errno = -__res; \
@@ -149,9 +190,15 @@ return -1; \
 type name(atype a) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
-	: "=a" (__res) \
-	: "0" (__NR_##name),"b" ((long)(a))); \
+if (__sysenter_ok()) \
+	__asm__ volatile (__SYSENTER \
+		: "=a" (__res) \
+		: "0" (__NR_##name),"b" ((long)(a)) \
+		: "memory"); \
+else \
+	__asm__ volatile ("int $0x80" \
+		: "=a" (__res) \
+		: "0" (__NR_##name),"b" ((long)(a))); \
 if (__res >= 0) \
 	return (type) __res; \
 errno = -__res; \
@@ -162,9 +209,15 @@ return -1; \
 type name(atype a,btype b) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
-	: "=a" (__res) \
-	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b))); \
+if (__sysenter_ok()) \
+	__asm__ volatile (__SYSENTER \
+		: "=a" (__res) \
+		: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)) \
+		: "memory"); \
+else \
+	__asm__ volatile ("int $0x80" \
+		: "=a" (__res) \
+		: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b))); \
 if (__res >= 0) \
 	return (type) __res; \
 errno = -__res; \
@@ -175,9 +228,15 @@ return -1; \
 type name(atype a,btype b,ctype c) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
-	: "=a" (__res) \
-	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)),"d" ((long)(c))); \
+if (__sysenter_ok()) \
+	__asm__ volatile (__SYSENTER \
+		: "=a" (__res) \
+		: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)),"d" ((long)(c)) \
+		: "memory"); \
+else \
+	__asm__ volatile ("int $0x80" \
+		: "=a" (__res) \
+		: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)),"d" ((long)(c))); \
 if (__res>=0) \
 	return (type) __res; \
 errno=-__res; \
@@ -252,5 +311,6 @@ int dup2(int oldfd, int newfd);
 int getppid(void);
 pid_t getpgrp(void);
 pid_t setsid(void);
+int clone(int (*fn)(void *), void * stack, int flags, void * arg);
 
 #endif
@@ -32,6 +32,7 @@ static inline _syscall0(int, sync)
 #include <linux/head.h>
 #include <asm/system.h>
 #include <asm/io.h>
+#include <asm/cpufeature.h>
 
 #include <stddef.h>
 #include <stdarg.h>
@@ -51,6 +52,7 @@ extern void hd_init(void);
 extern void floppy_init(void);
 extern void mem_init(long start, long end);
 extern long rd_init(long mem_start, int length);
+extern void zram_init(void);
 extern long kernel_mktime(struct tm * tm);
 extern long startup_time;
 
@@ -162,24 +164,27 @@ void main(void) /* This really IS void, no error here. */
         memory_end = 16 * 1024 * 1024;
     }
 
-    if (memory_end > 12 * 1024 * 1024) {
-        buffer_memory_end = 4 * 1024 * 1024;
-    } else if (memory_end > 6 * 1024 * 1024) {
-        buffer_memory_end = 2 * 1024 * 1024;
-    } else {
-        buffer_memory_end = 1 * 1024 * 1024;
-    }
+    /*
+     * Only the low memory left over by the kernel is set aside for
+     * buffers. Everything above 1M goes to the page allocator, and the
+     * buffer cache borrows pages from it as it needs them (see
+     * fs/buffer.c), so the two pools balance themselves.
+     */
+    buffer_memory_end = 1 * 1024 * 1024;
     main_memory_start = buffer_memory_end;
 
 #ifdef RAMDISK
     main_memory_start += rd_init(main_memory_start, RAMDISK * 1024);
 #endif
-    // 划分内核区（0-1M）、buffer区（1-4M）和主内存区（4M-）
+    // 划分内核区（0-end）、静态 buffer 区（end-640K）和主内存区（1M-）
     mem_init(main_memory_start, memory_end);
 
     // 初始化中断陷阱门和系统门
     trap_init();
 
+    // 识别 CPU 型号和特性（cpuid）
+    cpu_init();
+
     // 初始化块设备请求队列
     blk_dev_init();
 
@@ -200,6 +205,9 @@ void main(void) /* This really IS void, no error here. */
 
     floppy_init();
 
+    // 注册压缩内存盘（ramdisk 的 minor 2），并写好交换区头
+    zram_init();
+
     // 开启 CPU 中断允许标志（如定时器中断、键盘中断等）
     sti();
 
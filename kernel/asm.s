@@ -53,11 +53,45 @@ no_error_code:
     popl %eax
     iret                    			# 从中断返回，恢复程序执行
 
+/*
+ * sysenter doesn't clear TF, so a debug trap can come right at
+ * sysenter_entry, before it has loaded esp0, and an nmi can come there
+ * or in debug before it is fixed. Those frames are on sysenter_stack,
+ * 12 or 24 bytes below its esp0: the handler moves to the kernel stack
+ * and makes it look as if the trap came at sysenter_past_esp.
+ */
 debug:
-    pushl $do_int3        				# _do_debug
+    cmpl $sysenter_entry,(%esp)			# 是否陷入在 sysenter 入口的第一条指令前
+    jne debug_stack_correct
+debug_esp_fix_insn:
+    movl 12(%esp),%esp      			# 换到 esp0 所指的内核栈
+    pushfl                  			# 伪造一个在 sysenter_past_esp 处陷入的现场
+    pushl $0x08
+    pushl $sysenter_past_esp
+debug_stack_correct:
+    pushl $do_debug
     jmp no_error_code
 
 nmi:
+    cmpl $sysenter_entry,(%esp)			# 来在 sysenter 入口？
+    je nmi_stack_fixup
+    cmpl $sysenter_entry,12(%esp)		# 来在 debug 修正栈之前？
+    jne nmi_stack_correct
+    cmpw $0x08,16(%esp)
+    jne nmi_stack_correct
+    cmpl $debug,(%esp)
+    jb nmi_stack_correct
+    cmpl $debug_esp_fix_insn,(%esp)
+    ja nmi_stack_correct
+    movl 24(%esp),%esp      			# 连 debug 的现场一起丢掉
+    jmp nmi_fake_frame
+nmi_stack_fixup:
+    movl 12(%esp),%esp
+nmi_fake_frame:
+    pushfl
+    pushl $0x08
+    pushl $sysenter_past_esp
+nmi_stack_correct:
     pushl $do_nmi
     jmp no_error_code
 
@@ -1,6 +1,8 @@
 #ifndef _BLK_H
 #define _BLK_H
 
+#include <linux/blkstat.h>
+
 #define NR_BLK_DEV	7
 /*
  * NR_REQUEST is the number of entries in the request-queue.
@@ -30,6 +32,8 @@ struct request {
 	struct task_struct * waiting;
 	struct buffer_head * bh;
 	struct request * next;
+	struct blk_stat * stat;		/* NULL if not accounted */
+	unsigned long start;		/* usec_clock() when queued/started */
 };
 
 /*
@@ -51,6 +55,9 @@ extern struct blk_dev_struct blk_dev[NR_BLK_DEV];
 extern struct request request[NR_REQUEST];
 extern struct task_struct * wait_for_request;
 
+extern void blk_start_request(struct request * req);
+extern void blk_end_request(struct request * req, int uptodate);
+
 #ifdef MAJOR_NR
 
 /*
@@ -100,10 +107,9 @@ static void (DEVICE_REQUEST)(void);
 
 static inline void unlock_buffer(struct buffer_head * bh)
 {
-	if (!bh->b_lock)
+	if (!mutex_locked(&bh->b_lock))
 		printk(DEVICE_NAME ": free buffer being unlocked\n");
-	bh->b_lock=0;
-	wake_up(&bh->b_wait);
+	mutex_unlock(&bh->b_lock);
 }
 
 static inline void end_request(int uptodate)
@@ -120,8 +126,11 @@ static inline void end_request(int uptodate)
 	}
 	wake_up(&CURRENT->waiting);
 	wake_up(&wait_for_request);
+	blk_end_request(CURRENT,uptodate);
 	CURRENT->dev = -1;
 	CURRENT = CURRENT->next;
+	if (CURRENT)
+		blk_start_request(CURRENT);
 }
 
 #define INIT_REQUEST \
@@ -131,7 +140,7 @@ repeat: \
 	if (MAJOR(CURRENT->dev) != MAJOR_NR) \
 		panic(DEVICE_NAME ": request list destroyed"); \
 	if (CURRENT->bh) { \
-		if (!CURRENT->bh->b_lock) \
+		if (!mutex_locked(&CURRENT->bh->b_lock)) \
 			panic(DEVICE_NAME ": block not locked"); \
 	}
 
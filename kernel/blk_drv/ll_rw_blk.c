@@ -10,7 +10,9 @@
 #include <errno.h>
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/spinlock.h>
 #include <asm/system.h>
+#include <asm/segment.h>
 
 #include "blk.h"
 
@@ -25,6 +27,13 @@ struct request request[NR_REQUEST];
  */
 struct task_struct * wait_for_request = NULL;
 
+/*
+ * request_lock guards the request slots, the device queues and the
+ * statistics. end_request() changes them from interrupts, so it is
+ * always taken with interrupts off.
+ */
+spinlock_t request_lock = SPIN_LOCK_UNLOCKED;
+
 /* blk_dev_struct is:
  *	do_request-address
  *	next-request
@@ -39,39 +48,156 @@ struct blk_dev_struct blk_dev[NR_BLK_DEV] = {
 	{ NULL, NULL }		/* dev lp */
 };
 
+/*
+ * Per-device statistics, see <linux/blkstat.h>. The counters are
+ * changed under request_lock, as end_request() runs from interrupts.
+ */
+static struct blk_stat blk_stat[NR_BLKSTAT];
+
+static struct blk_stat * find_blk_stat(int dev)
+{
+	struct blk_stat * s, * empty = NULL;
+
+	for (s = blk_stat ; s < blk_stat + NR_BLKSTAT ; s++) {
+		if (s->dev == dev)
+			return s;
+		if (s->dev < 0 && !empty)
+			empty = s;
+	}
+	if (empty)
+		empty->dev = dev;
+	return empty;
+}
+
+static inline void blk_hist(unsigned long * hist, unsigned long usec)
+{
+	int i = 0;
+
+	while ((usec >>= 1) && i < BLK_HIST-1)
+		i++;
+	hist[i]++;
+}
+
+void blk_start_request(struct request * req)
+{
+	unsigned long now;
+
+	if (!req->stat)
+		return;
+	now = usec_clock();
+	blk_hist(req->stat->queue_hist, now - req->start);
+	req->start = now;
+}
+
+void blk_end_request(struct request * req, int uptodate)
+{
+	struct blk_stat * s = req->stat;
+	unsigned long now;
+
+	if (!s)
+		return;
+	now = usec_clock();
+	blk_hist(s->service_hist, now - req->start);
+	if (!uptodate)
+		s->errors++;
+	if (!--s->in_queue)
+		s->busy += now - s->busy_start;
+}
+
+static void blk_queue_request(struct request * req)
+{
+	struct blk_stat * s;
+
+	if (!(s = req->stat = find_blk_stat(req->dev)))
+		return;
+	req->start = usec_clock();
+	s->ios[req->cmd]++;
+	s->sectors[req->cmd] += req->nr_sectors;
+	s->depth_sum += s->in_queue;
+	if (!s->in_queue++)
+		s->busy_start = req->start;
+	if (s->in_queue > s->max_queue)
+		s->max_queue = s->in_queue;
+}
+
+/*
+ * Clearing keeps the slots of devices with requests in flight, so that
+ * their queue depth stays right.
+ */
+static void clear_blk_stat(struct blk_stat * s)
+{
+	int dev = s->in_queue ? s->dev : -1;
+	unsigned long in_queue = s->in_queue;
+	unsigned long now = usec_clock();
+	int i;
+
+	for (i=0 ; i<sizeof *s ; i++)
+		((char *) s)[i] = 0;
+	s->dev = dev;
+	s->in_queue = s->max_queue = in_queue;
+	s->busy_start = now;
+}
+
+int sys_blkstat(int slot, struct blk_stat * buf)
+{
+	struct blk_stat copy;
+	unsigned long flags;
+	int i;
+
+	if (slot < 0) {
+		if (!suser())
+			return -EPERM;
+		spin_lock_irqsave(&request_lock,flags);
+		for (i=0 ; i<NR_BLKSTAT ; i++)
+			clear_blk_stat(blk_stat+i);
+		spin_unlock_irqrestore(&request_lock,flags);
+		return 0;
+	}
+	if (slot >= NR_BLKSTAT)
+		return -EINVAL;
+	if (blk_stat[slot].dev < 0)
+		return -ENOENT;
+	if (verify_area(buf,sizeof *buf))
+		return -EFAULT;
+	spin_lock_irqsave(&request_lock,flags);
+	copy = blk_stat[slot];
+	spin_unlock_irqrestore(&request_lock,flags);
+	for (i=0 ; i<sizeof *buf ; i++)
+		put_fs_byte(((char *) &copy)[i],i+(char *) buf);
+	return copy.dev;
+}
+
 static inline void lock_buffer(struct buffer_head * bh)
 {
-	cli();
-	while (bh->b_lock)
-		sleep_on(&bh->b_wait);
-	bh->b_lock=1;
-	sti();
+	mutex_lock(&bh->b_lock);
 }
 
 static inline void unlock_buffer(struct buffer_head * bh)
 {
-	if (!bh->b_lock)
+	if (!mutex_locked(&bh->b_lock))
 		printk("ll_rw_block.c: buffer not locked\n\r");
-	bh->b_lock = 0;
-	wake_up(&bh->b_wait);
+	mutex_unlock(&bh->b_lock);
 }
 
 /*
  * add-request adds a request to the linked list.
- * It disables interrupts so that it can muck with the
+ * It takes request_lock so that it can muck with the
  * request-lists in peace.
  */
 static void add_request(struct blk_dev_struct * dev, struct request * req)
 {
 	struct request * tmp;
+	unsigned long flags;
 
 	req->next = NULL;
-	cli();
+	spin_lock_irqsave(&request_lock,flags);
 	if (req->bh)
 		req->bh->b_dirt = 0;
+	blk_queue_request(req);
 	if (!(tmp = dev->current_request)) {
 		dev->current_request = req;
-		sti();
+		blk_start_request(req);
+		spin_unlock_irqrestore(&request_lock,flags);
 		(dev->request_fn)();
 		return;
 	}
@@ -82,18 +208,19 @@ static void add_request(struct blk_dev_struct * dev, struct request * req)
 			break;
 	req->next=tmp->next;
 	tmp->next=req;
-	sti();
+	spin_unlock_irqrestore(&request_lock,flags);
 }
 
 static void make_request(int major,int rw, struct buffer_head * bh)
 {
 	struct request * req;
+	unsigned long flags;
 	int rw_ahead;
 
 /* WRITEA/READA is special case - it is not really needed, so if the */
 /* buffer is locked, we just forget about it, else it's a normal read */
 	if ((rw_ahead = (rw == READA || rw == WRITEA))) {
-		if (bh->b_lock)
+		if (mutex_locked(&bh->b_lock))
 			return;
 		if (rw == READA)
 			rw = READ;
@@ -116,10 +243,14 @@ repeat:
 		req = request+NR_REQUEST;
 	else
 		req = request+((NR_REQUEST*2)/3);
-/* find an empty request */
+/* find an empty request, and claim it before anyone else can */
+	spin_lock_irqsave(&request_lock,flags);
 	while (--req >= request)
 		if (req->dev<0)
 			break;
+	if (req >= request)
+		req->dev = bh->b_dev;
+	spin_unlock_irqrestore(&request_lock,flags);
 /* if none found, sleep on new requests: check for rw_ahead */
 	if (req < request) {
 		if (rw_ahead) {
@@ -130,7 +261,6 @@ repeat:
 		goto repeat;
 	}
 /* fill up the request-info, and add it to the queue */
-	req->dev = bh->b_dev;
 	req->cmd = rw;
 	req->errors=0;
 	req->sector = bh->b_blocknr<<1;
@@ -169,4 +299,9 @@ void blk_dev_init(void)
         request[i].dev = -1;
         request[i].next = NULL;
     }
+
+    // 清空块设备统计槽位
+    for (i = 0; i < NR_BLKSTAT; i++) {
+        blk_stat[i].dev = -1;
+    }
 }
@@ -20,12 +20,21 @@
 char	*rd_start;
 int	rd_length = 0;
 
+extern int zram_rw(int cmd, unsigned long sector, unsigned long nr_sectors,
+	char * buf);
+extern void zram_mkswap(void);
+
 void do_rd_request(void)
 {
 	int	len;
 	char	*addr;
 
 	INIT_REQUEST;
+	if (MINOR(CURRENT->dev) == 2) {
+		end_request(zram_rw(CURRENT->cmd,CURRENT->sector,
+			CURRENT->nr_sectors,CURRENT->buffer));
+		goto repeat;
+	}
 	addr = rd_start + (CURRENT->sector << 9);
 	len = CURRENT->nr_sectors << 9;
 	if ((MINOR(CURRENT->dev) != 1) || (addr+len > rd_start+rd_length)) {
@@ -63,6 +72,16 @@ long rd_init(long mem_start, int length)
 	return(length);
 }
 
+/*
+ * The compressed ram disk takes its memory as it fills, so it is there
+ * even without a ram disk.
+ */
+void zram_init(void)
+{
+	blk_dev[MAJOR_NR].request_fn = DEVICE_REQUEST;
+	zram_mkswap();
+}
+
 /*
  * If the root device is the ram disk, try to load it.
  * In order to do this, the root device is originally set to the
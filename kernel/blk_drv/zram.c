@@ -0,0 +1,373 @@
+/*
+ *  linux/kernel/blk_drv/zram.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * The compressed ram disk: minor 2 of the ram disk, which hands us its
+ * requests. Every 1K block is LZ-compressed on its own and kept in
+ * 32-byte chunks of pool pages taken from the page allocator as the
+ * disk fills. Blocks that were never written, or were written as all
+ * zeroes, take no room at all, and blocks that don't compress are kept
+ * as they are.
+ *
+ * It is meant as a swap device: when memory runs out, swapped pages are
+ * kept here in a fraction of their size instead of killing the task or
+ * going to the disk. zram_mkswap() writes the swap header at boot, and
+ * swap_free() tells us about the slots that are no longer used.
+ *
+ * A swap write is usually what frees memory, so it mustn't depend on
+ * get_free_page() itself: the block table is allocated whole by
+ * zram_mkswap(), and ZRAM_RESERVE pool pages are kept back for the
+ * times get_free_page() has none to give.
+ *
+ * Nothing here sleeps. Requests come from process context only, as the
+ * ram disk does its work at once from add_request().
+ */
+
+#include <string.h>
+
+#include <linux/config.h>
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/kernel.h>
+
+#define ZRAM_BLOCKS (ZRAM_PAGES*4)
+
+#define CHUNK_SIZE 32
+#define CHUNKS (PAGE_SIZE/CHUNK_SIZE)		/* chunk 0 holds the map */
+#define NR_POOL (ZRAM_BLOCKS/3+1)		/* 3 raw blocks to a page */
+#define ZRAM_RESERVE 4				/* enough for a swapped page */
+
+#define RAW_SIZE BLOCK_SIZE
+#define MAX_MATCH 34
+#define NR_LZ_HASH 1024
+#define lz_hashfn(p) ((((p)[0]<<5) ^ ((p)[1]<<2) ^ (p)[2]) & (NR_LZ_HASH-1))
+
+struct zram_slot {
+	unsigned short pool;
+	unsigned short size;		/* 0: all zeroes, RAW_SIZE: stored as is */
+	unsigned char chunk;
+};
+
+#define SLOTS_PER_PAGE (PAGE_SIZE/sizeof(struct zram_slot))
+#define NR_SLOT_PAGES ((ZRAM_BLOCKS+SLOTS_PER_PAGE-1)/SLOTS_PER_PAGE)
+
+struct pool_head {
+	unsigned long map[CHUNKS/32];	/* chunks in use */
+	int free;
+};
+
+static struct zram_slot * slot_page[NR_SLOT_PAGES];
+static struct pool_head * pool_page[NR_POOL];
+static int nr_pool = 0;
+static unsigned long reserve[ZRAM_RESERVE];
+static int nr_reserve = 0;
+static unsigned short lz_hash[NR_LZ_HASH];
+static unsigned char zbuf[BLOCK_SIZE];
+
+#define chunk_used(h,n) ((h)->map[(n)>>5] & (1 << ((n) & 31)))
+
+/*
+ * A literal run is a byte 0..127 (length-1) followed by the bytes, a
+ * match is two bytes: 1, 5 bits of length-3 and 10 bits of distance.
+ * Returns the compressed size, or 0 if it would exceed 'limit'.
+ */
+static int lz_compress(unsigned char * src, unsigned char * dst, int limit)
+{
+	int pos = 0, lit = 0, out = 0, len, cand, h, n;
+
+	while (pos < BLOCK_SIZE) {
+		len = 0;
+		if (pos + 3 <= BLOCK_SIZE) {
+			h = lz_hashfn(src+pos);
+			cand = lz_hash[h];
+			lz_hash[h] = pos;
+			if (cand < pos && pos - cand < 1024)
+				while (len < MAX_MATCH && pos+len < BLOCK_SIZE &&
+				    src[cand+len] == src[pos+len])
+					len++;
+		}
+		if (len < 3) {
+			pos++;
+			continue;
+		}
+		while (lit < pos) {
+			n = pos - lit;
+			if (n > 128)
+				n = 128;
+			if (out + 1 + n > limit)
+				return 0;
+			dst[out++] = n-1;
+			memcpy(dst+out,src+lit,n);
+			out += n;
+			lit += n;
+		}
+		if (out + 2 > limit)
+			return 0;
+		dst[out++] = 0x80 | ((len-3) << 2) | ((pos-cand) >> 8);
+		dst[out++] = pos-cand;
+		pos += len;
+		lit = pos;
+	}
+	while (lit < BLOCK_SIZE) {
+		n = BLOCK_SIZE - lit;
+		if (n > 128)
+			n = 128;
+		if (out + 1 + n > limit)
+			return 0;
+		dst[out++] = n-1;
+		memcpy(dst+out,src+lit,n);
+		out += n;
+		lit += n;
+	}
+	return out;
+}
+
+static int lz_decompress(unsigned char * src, int size, unsigned char * dst)
+{
+	int in = 0, out = 0, len, dist;
+
+	while (in < size) {
+		if (src[in] & 0x80) {
+			len = ((src[in] >> 2) & 31) + 3;
+			dist = ((src[in] & 3) << 8) | src[in+1];
+			in += 2;
+			if (!dist || dist > out || out + len > BLOCK_SIZE)
+				return 0;
+			for ( ; len ; len--,out++)
+				dst[out] = dst[out-dist];
+		} else {
+			len = src[in++] + 1;
+			if (out + len > BLOCK_SIZE)
+				return 0;
+			memcpy(dst+out,src+in,len);
+			in += len;
+			out += len;
+		}
+	}
+	return out == BLOCK_SIZE;
+}
+
+static struct zram_slot * get_slot(int nr)
+{
+	return slot_page[nr / SLOTS_PER_PAGE] + nr % SLOTS_PER_PAGE;
+}
+
+/*
+ * Pool pages come from the reserve only when get_free_page() fails,
+ * and freed ones go back to it first.
+ */
+static unsigned long get_pool_page(void)
+{
+	unsigned long page;
+
+	if ((page = get_free_page()))
+		return page;
+	if (nr_reserve)
+		return reserve[--nr_reserve];
+	return 0;
+}
+
+static void put_pool_page(unsigned long page)
+{
+	if (nr_reserve < ZRAM_RESERVE)
+		reserve[nr_reserve++] = page;
+	else
+		free_page(page);
+}
+
+static void fill_reserve(void)
+{
+	unsigned long page;
+
+	while (nr_reserve < ZRAM_RESERVE && (page = get_free_page()))
+		reserve[nr_reserve++] = page;
+}
+
+static int alloc_in_pool(int pool, int n)
+{
+	struct pool_head * h = pool_page[pool];
+	int i, j;
+
+	if (h->free < n)
+		return 0;
+	for (i=1 ; i+n <= CHUNKS ; i++) {
+		for (j=0 ; j<n ; j++)
+			if (chunk_used(h,i+j))
+				break;
+		if (j < n) {
+			i += j;
+			continue;
+		}
+		for (j=0 ; j<n ; j++)
+			h->map[(i+j)>>5] |= 1 << ((i+j) & 31);
+		h->free -= n;
+		return i;
+	}
+	return 0;
+}
+
+/*
+ * Find 'n' free chunks in a row, adding a pool page if none has them.
+ * Returns the first chunk and sets *pool, or returns 0.
+ */
+static int alloc_chunks(int n, int * pool)
+{
+	struct pool_head * h;
+	int i, empty = -1, chunk;
+
+	for (i=0 ; i<nr_pool ; i++) {
+		if (!pool_page[i]) {
+			if (empty < 0)
+				empty = i;
+			continue;
+		}
+		if ((chunk = alloc_in_pool(i,n))) {
+			*pool = i;
+			return chunk;
+		}
+	}
+	if (empty < 0) {
+		if (nr_pool >= NR_POOL)
+			return 0;
+		empty = nr_pool;
+	}
+	if (!(h = (struct pool_head *) get_pool_page()))
+		return 0;
+	for (i=1 ; i<CHUNKS/32 ; i++)
+		h->map[i] = 0;
+	h->map[0] = 1;
+	h->free = CHUNKS-1;
+	pool_page[empty] = h;
+	if (empty >= nr_pool)
+		nr_pool = empty+1;
+	*pool = empty;
+	return alloc_in_pool(empty,n);
+}
+
+static void free_slot(struct zram_slot * slot)
+{
+	struct pool_head * h;
+	int i, n;
+
+	if (!slot->size)
+		return;
+	h = pool_page[slot->pool];
+	n = (slot->size + CHUNK_SIZE-1) / CHUNK_SIZE;
+	for (i=slot->chunk ; i<slot->chunk+n ; i++)
+		h->map[i>>5] &= ~(1 << (i & 31));
+	h->free += n;
+	slot->size = 0;
+	if (h->free == CHUNKS-1) {
+		put_pool_page((unsigned long) h);
+		pool_page[slot->pool] = NULL;
+	}
+}
+
+static int zram_write(int nr, char * buf)
+{
+	struct zram_slot * slot;
+	unsigned char * data = zbuf;
+	int i, size, pool, chunk;
+
+	for (i=0 ; i<BLOCK_SIZE/4 ; i++)
+		if (((unsigned long *) buf)[i])
+			break;
+	slot = get_slot(nr);
+	if (i == BLOCK_SIZE/4) {
+		free_slot(slot);
+		return 1;
+	}
+/* taken back now, while there may be something to take */
+	fill_reserve();
+	if (!(size = lz_compress((unsigned char *) buf,zbuf,
+	    RAW_SIZE - CHUNK_SIZE))) {
+		size = RAW_SIZE;
+		data = (unsigned char *) buf;
+	}
+/* the old copy stays if there is no room for the new one */
+	if (!(chunk = alloc_chunks((size + CHUNK_SIZE-1) / CHUNK_SIZE,&pool)))
+		return 0;
+	free_slot(slot);
+	memcpy(chunk*CHUNK_SIZE + (char *) pool_page[pool],data,size);
+	slot->pool = pool;
+	slot->chunk = chunk;
+	slot->size = size;
+	return 1;
+}
+
+static int zram_read(int nr, char * buf)
+{
+	struct zram_slot * slot;
+	unsigned char * data;
+	int i;
+
+	slot = get_slot(nr);
+	if (!slot->size) {
+		for (i=0 ; i<BLOCK_SIZE/4 ; i++)
+			((unsigned long *) buf)[i] = 0;
+		return 1;
+	}
+	data = slot->chunk*CHUNK_SIZE + (unsigned char *) pool_page[slot->pool];
+	if (slot->size == RAW_SIZE) {
+		memcpy(buf,data,BLOCK_SIZE);
+		return 1;
+	}
+	return lz_decompress(data,slot->size,(unsigned char *) buf);
+}
+
+/*
+ * Called by do_rd_request() for minor 2. Returns 1 if all went well.
+ */
+int zram_rw(int cmd, unsigned long sector, unsigned long nr_sectors,
+	char * buf)
+{
+	unsigned long nr = sector >> 1;
+
+	if ((sector & 1) || (nr_sectors & 1) ||
+	    nr + (nr_sectors >> 1) > ZRAM_BLOCKS)
+		return 0;
+	for ( ; nr_sectors ; nr_sectors -= 2, nr++, buf += BLOCK_SIZE)
+		if (!(cmd == WRITE ? zram_write(nr,buf) : zram_read(nr,buf)))
+			return 0;
+	return 1;
+}
+
+/*
+ * The blocks are no longer used: give their memory back.
+ */
+void zram_discard(int block, int count)
+{
+	for ( ; count-- > 0 && block < ZRAM_BLOCKS ; block++)
+		free_slot(get_slot(block));
+}
+
+/*
+ * Set up the block table and the reserve, and write the header mkswap
+ * would: all pages but the header itself are usable. The bitmap is
+ * mostly ones and costs almost nothing.
+ */
+void zram_mkswap(void)
+{
+	unsigned long page;
+	int i;
+
+	for (i=0 ; i<NR_SLOT_PAGES ; i++)
+		if (!(slot_page[i] = (struct zram_slot *) get_free_page()))
+			panic("zram: no memory for the block table");
+	fill_reserve();
+	if (!(page = get_free_page()))
+		panic("zram: no memory for the swap header");
+	for (i=1 ; i<ZRAM_PAGES ; i++)
+		((char *) page)[i>>3] |= 1 << (i & 7);
+	for (i=0 ; i<10 ; i++)
+		((char *) page)[4086+i] = "SWAP-SPACE"[i];
+	for (i=0 ; i<4 ; i++)
+		if (!zram_write(i,i*BLOCK_SIZE + (char *) page))
+			panic("zram: unable to write the swap header");
+	free_page(page);
+	printk("zram: %d pages of compressed swap on %04x\n\r",
+		ZRAM_PAGES,ZRAM_DEV);
+}
@@ -134,13 +134,12 @@ void tty_init(void)
 
 void tty_intr(struct tty_struct * tty, int mask)
 {
-    int i;
+    struct task_struct * p;
 
     if (tty->pgrp <= 0)
         return;
-    for (i=0;i<NR_TASKS;i++)
-        if (task[i] && task[i]->pgrp==tty->pgrp)
-            task[i]->signal |= mask;
+    for_each_task_pid(tty->pgrp, PIDTYPE_PGID, p)
+        p->signal |= mask;
 }
 
 static void sleep_if_empty(struct tty_queue * queue)
@@ -0,0 +1,111 @@
+/*
+ *  linux/kernel/cpu.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 'cpu.c' finds out what kind of processor we are running on. A 386
+ * can't toggle the AC flag, a 486 without cpuid can't toggle the ID
+ * flag, and everything newer tells us about itself through cpuid.
+ *
+ * From the 486 on, CR0.WP makes the kernel respect write protection in
+ * user pages, so kernel writes to copy-on-write pages fault into
+ * do_wp_page() by themselves and verify_area() has nothing to do.
+ *
+ * Processors with SEP get a sysenter entry for system calls as well.
+ * With FXSR, CR4.OSFXSR says we save the SSE registers on task switches
+ * (see math_state_restore()), so user code may use them. CR4.OSXMMEXCPT
+ * has unmasked SSE exceptions trap to int 19 instead of int 6.
+ */
+#include <asm/cpufeature.h>
+
+#define EFLAGS_AC 0x00040000
+#define EFLAGS_ID 0x00200000
+#define CR0_WP 0x00010000
+#define CR4_OSFXSR 0x00000200
+#define CR4_OSXMMEXCPT 0x00000400
+
+int x86 = 3;
+unsigned long x86_capability = 0;
+static int x86_model, x86_mask;
+
+static int flag_is_changeable(unsigned long flag)
+{
+	unsigned long f1, f2;
+
+	__asm__("pushfl\n\t"
+		"pushfl\n\t"
+		"popl %0\n\t"
+		"movl %0,%1\n\t"
+		"xorl %2,%0\n\t"
+		"pushl %0\n\t"
+		"popfl\n\t"
+		"pushfl\n\t"
+		"popl %0\n\t"
+		"popfl"
+		:"=&r" (f1),"=&r" (f2)
+		:"ir" (flag));
+	return ((f1^f2) & flag) != 0;
+}
+
+static void identify_cpu(void)
+{
+	unsigned long eax, ebx, ecx, edx;
+
+	if (!flag_is_changeable(EFLAGS_AC))
+		return;
+	x86 = 4;
+	if (!flag_is_changeable(EFLAGS_ID))
+		return;
+	__asm__("cpuid"
+		:"=a" (eax),"=b" (ebx),"=c" (ecx),"=d" (edx)
+		:"0" (0));
+	if (eax < 1)
+		return;
+	__asm__("cpuid"
+		:"=a" (eax),"=b" (ebx),"=c" (ecx),"=d" (edx)
+		:"0" (1));
+	x86 = (eax >> 8) & 0xf;
+	x86_model = (eax >> 4) & 0xf;
+	x86_mask = eax & 0xf;
+	x86_capability = edx;
+}
+
+void cpu_init(void)
+{
+	unsigned long cr4;
+
+	identify_cpu();
+	if (x86 > 3)
+		__asm__("movl %%cr0,%%eax\n\t"
+			"orl %0,%%eax\n\t"
+			"movl %%eax,%%cr0"
+			::"i" (CR0_WP):"ax");
+	if (cpu_has(X86_FEATURE_FXSR)) {
+		cr4 = CR4_OSFXSR;
+		if (cpu_has(X86_FEATURE_SSE))
+			cr4 |= CR4_OSXMMEXCPT;
+		__asm__("movl %%cr4,%%eax\n\t"
+			"orl %0,%%eax\n\t"
+			"movl %%eax,%%cr4"
+			::"r" (cr4):"ax");
+	}
+}
+
+/*
+ * sysenter_init() points the sysenter MSRs at 'entry', with the stack
+ * pointer read from 'esp', and returns 1 if it could. Early Pentium
+ * Pros claim SEP without having it.
+ */
+int sysenter_init(unsigned long esp, void (*entry)(void))
+{
+	if (!cpu_has(X86_FEATURE_SEP))
+		return 0;
+	if (x86 == 6 && x86_model < 3 && x86_mask < 3)
+		return 0;
+	wrmsr(MSR_SYSENTER_CS, 0x08, 0);
+	wrmsr(MSR_SYSENTER_ESP, esp, 0);
+	wrmsr(MSR_SYSENTER_EIP, (unsigned long) entry, 0);
+	return 1;
+}
@@ -11,6 +11,7 @@
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/tty.h>
+#include <linux/slab.h>
 #include <asm/segment.h>
 
 int sys_pause(void);
@@ -24,7 +25,12 @@ void release(struct task_struct * p)
 		return;
 	for (i=1 ; i<NR_TASKS ; i++)
 		if (task[i]==p) {
+			unlink_task(p);
 			task[i]=NULL;
+			mmput(p->mm);
+#ifdef SYSCALL_STATS
+			free_page((long)p->sc_stat);
+#endif
 			free_page((long)p);
 			schedule();
 			return;
@@ -45,12 +51,10 @@ static inline int send_sig(long sig,struct task_struct * p,int priv)
 
 static void kill_session(void)
 {
-	struct task_struct **p = NR_TASKS + task;
-	
-	while (--p > &FIRST_TASK) {
-		if (*p && (*p)->session == current->session)
-			(*p)->signal |= 1<<(SIGHUP-1);
-	}
+	struct task_struct *p;
+
+	for_each_task_pid(current->session,PIDTYPE_SID,p)
+		p->signal |= 1<<(SIGHUP-1);
 }
 
 /*
@@ -60,64 +64,87 @@ static void kill_session(void)
 int sys_kill(int pid,int sig)
 {
 	struct task_struct **p = NR_TASKS + task;
+	struct task_struct *t;
 	int err, retval = 0;
 
-	if (!pid) while (--p > &FIRST_TASK) {
-		if (*p && (*p)->pgrp == current->pid) 
-			if ((err=send_sig(sig,*p,1)))
+	if (!pid) {
+		for_each_task_pid(current->pid,PIDTYPE_PGID,t)
+			if ((err=send_sig(sig,t,1)))
 				retval = err;
-	} else if (pid>0) while (--p > &FIRST_TASK) {
-		if (*p && (*p)->pid == pid) 
-			if ((err=send_sig(sig,*p,0)))
+	} else if (pid>0) {
+		if ((t = find_task_by_pid(pid)))
+			if ((err=send_sig(sig,t,0)))
 				retval = err;
 	} else if (pid == -1) while (--p > &FIRST_TASK) {
 		if ((err = send_sig(sig,*p,0)))
 			retval = err;
-	} else while (--p > &FIRST_TASK)
-		if (*p && (*p)->pgrp == -pid)
-			if ((err = send_sig(sig,*p,0)))
+	} else
+		for_each_task_pid(-pid,PIDTYPE_PGID,t)
+			if ((err = send_sig(sig,t,0)))
 				retval = err;
 	return retval;
 }
 
-static void tell_father(int pid)
+static void tell_father(void)
 {
-	int i;
-
-	if (pid)
-		for (i=0;i<NR_TASKS;i++) {
-			if (!task[i])
-				continue;
-			if (task[i]->pid != pid)
-				continue;
-			task[i]->signal |= (1<<(SIGCHLD-1));
-			return;
-		}
+	if (current->p_pptr) {
+		current->p_pptr->signal |= (1<<(SIGCHLD-1));
+		return;
+	}
 /* if we don't find any fathers, we just release ourselves */
-/* This is not really OK. Must change it to make father 1 */
 	printk("BAD BAD - no father found\n\r");
 	release(current);
 }
 
-int do_exit(long code)
+/*
+ * The address space, the files and the fs info may be shared with
+ * clone(): only the last task using them gives them up. The page
+ * directory stays until release(), as the zombie still runs on it.
+ * execve() calls exit_mm() too, when it leaves a shared mm.
+ */
+void exit_mm(void)
 {
+	if (--current->mm->users)
+		return;
+	exit_mmap(current);
+	free_page_tables(task_pg_dir(current),
+		get_base(current->ldt[1]),get_limit(0x0f));
+	free_page_tables(task_pg_dir(current),
+		get_base(current->ldt[2]),get_limit(0x17));
+}
+
+static void exit_files(void)
+{
+	struct files_struct * files = current->files;
 	int i;
-	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
-	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
-	for (i=0 ; i<NR_TASKS ; i++)
-		if (task[i] && task[i]->father == current->pid) {
-			task[i]->father = 1;
-			if (task[i]->state == TASK_ZOMBIE)
-				/* assumption task[1] is always init */
-				(void) send_sig(SIGCHLD, task[1], 1);
-		}
-	for (i=0 ; i<NR_OPEN ; i++)
-		if (current->filp[i])
-			sys_close(i);
-	iput(current->pwd);
-	current->pwd=NULL;
-	iput(current->root);
-	current->root=NULL;
+
+	if (files->count == 1)
+		for (i=0 ; i<NR_OPEN ; i++)
+			if (files->fd[i])
+				sys_close(i);
+	if (!--files->count)
+		kmem_cache_free(&files_cache, files);
+	current->files = NULL;
+}
+
+static void exit_fs(void)
+{
+	struct fs_struct * fs = current->fs;
+
+	if (!--fs->count) {
+		iput(fs->pwd);
+		iput(fs->root);
+		kmem_cache_free(&fs_cache, fs);
+	}
+	current->fs = NULL;
+}
+
+int do_exit(long code)
+{
+	exit_mm();
+	reparent_children(current);
+	exit_files();
+	exit_fs();
 	iput(current->executable);
 	current->executable=NULL;
 	if (current->leader && current->tty >= 0)
@@ -128,7 +155,7 @@ int do_exit(long code)
 		kill_session();
 	current->state = TASK_ZOMBIE;
 	current->exit_code = code;
-	tell_father(current->father);
+	tell_father();
 	schedule();
 	return (-1);	/* just to suppress warnings */
 }
@@ -141,38 +168,35 @@ int sys_exit(int error_code)
 int sys_waitpid(pid_t pid,unsigned long * stat_addr, int options)
 {
 	int flag, code;
-	struct task_struct ** p;
+	struct task_struct * p;
 
-	verify_area(stat_addr,4);
+	if (verify_area(stat_addr,4))
+		return -EFAULT;
 repeat:
 	flag=0;
-	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p) {
-		if (!*p || *p == current)
-			continue;
-		if ((*p)->father != current->pid)
-			continue;
+	for (p = current->p_cptr ; p ; p = p->p_osptr) {
 		if (pid>0) {
-			if ((*p)->pid != pid)
+			if (p->pid != pid)
 				continue;
 		} else if (!pid) {
-			if ((*p)->pgrp != current->pgrp)
+			if (p->pgrp != current->pgrp)
 				continue;
 		} else if (pid != -1) {
-			if ((*p)->pgrp != -pid)
+			if (p->pgrp != -pid)
 				continue;
 		}
-		switch ((*p)->state) {
+		switch (p->state) {
 			case TASK_STOPPED:
 				if (!(options & WUNTRACED))
 					continue;
 				put_fs_long(0x7f,stat_addr);
-				return (*p)->pid;
+				return p->pid;
 			case TASK_ZOMBIE:
-				current->cutime += (*p)->utime;
-				current->cstime += (*p)->stime;
-				flag = (*p)->pid;
-				code = (*p)->exit_code;
-				release(*p);
+				current->cutime += p->utime;
+				current->cstime += p->stime;
+				flag = p->pid;
+				code = p->exit_code;
+				release(p);
 				put_fs_long(code,stat_addr);
 				return flag;
 			default:
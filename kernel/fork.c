@@ -12,21 +12,49 @@
  */
 #include <string.h>
 #include <errno.h>
+#include <sys/mman.h>
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/timepage.h>
 #include <asm/segment.h>
 #include <asm/system.h>
+#include <asm/cpufeature.h>
 
 extern void write_verify(unsigned long address);
+extern void ret_from_fork(void);
 
 long last_pid = 0;
 
-void verify_area(void * addr,int size)
+/*
+ * verify_area() returns -EFAULT if the kernel may not write the area:
+ * if it wraps, runs into the time page, or takes in an mmap()ed area
+ * that isn't writable. A write fault there would kill the task in the
+ * middle of the system call.
+ *
+ * A 386 ignores write protection in kernel mode, so pages the kernel is
+ * about to write have to be un-shared up front. cpu_init() sets CR0.WP
+ * on anything newer, where the writes fault like user ones do.
+ */
+int verify_area(void * addr,int size)
 {
-	unsigned long start;
+	unsigned long start, end;
+	struct vm_area_struct * area;
 
+	if (size <= 0)
+		return 0;
 	start = (unsigned long) addr;
+	end = start + size;
+	if (end < start || end > TIME_PAGE_ADDR)
+		return -EFAULT;
+	for (area = current->mm->mmap ; area && area->vm_start < end ;
+	     area = area->vm_next)
+		if (area->vm_end > start && !(area->vm_prot & PROT_WRITE))
+			return -EFAULT;
+	if (x86 > 3)
+		return 0;
+
 	size += start & 0xfff;
 	start &= 0xfffff000;
 	start += get_base(current->ldt[2]);
@@ -35,6 +63,7 @@ void verify_area(void * addr,int size)
 		write_verify(start);
 		start += 4096;
 	}
+	return 0;
 }
 
 int copy_mem(int nr,struct task_struct * p)
@@ -50,36 +79,112 @@ int copy_mem(int nr,struct task_struct * p)
 		panic("We don't support separate I&D");
 	if (data_limit < code_limit)
 		panic("Bad data_limit");
-	new_data_base = new_code_base = nr * 0x4000000;
+	new_data_base = new_code_base = TASK_BASE;
 	p->start_code = new_code_base;
 	set_base(p->ldt[1], new_code_base);
 	set_base(p->ldt[2], new_data_base);
-	if (copy_page_tables(old_data_base, new_data_base, data_limit)) {
+	if (!(p->tss.cr3 = (long) new_page_dir()))
+		return -ENOMEM;
+	if (copy_page_tables(task_pg_dir(current), old_data_base,
+	    task_pg_dir(p), new_data_base, data_limit)) {
 		printk("free_page_tables: from copy_mem\n");
-		free_page_tables(new_data_base,data_limit);
+		free_page_tables(task_pg_dir(p),new_data_base,data_limit);
+		free_page(p->tss.cr3);
 		return -ENOMEM;
 	}
     
 	return 0;
 }
 
+/*
+ * What clone() can share between tasks comes from these caches: the
+ * address space, the open files and the fs info.
+ */
+struct kmem_cache mm_cache = KMEM_CACHE("mm", struct mm_struct, NULL);
+struct kmem_cache files_cache = KMEM_CACHE("files", struct files_struct, NULL);
+struct kmem_cache fs_cache = KMEM_CACHE("fs", struct fs_struct, NULL);
+
+/* a new address space with nothing mapped yet, for execve() */
+struct mm_struct * mm_alloc(void)
+{
+	struct mm_struct * mm;
+
+	if (!(mm = kmem_cache_alloc(&mm_cache)))
+		return NULL;
+	if (!(mm->pg_dir = (unsigned long) new_page_dir())) {
+		kmem_cache_free(&mm_cache, mm);
+		return NULL;
+	}
+	mm->users = mm->count = 1;
+	mm->brk = 0;
+	mm->mmap = NULL;
+	return mm;
+}
+
+/* release() drops the last reference of a task to its address space */
+void mmput(struct mm_struct * mm)
+{
+	if (--mm->count)
+		return;
+	free_page(mm->pg_dir);
+	kmem_cache_free(&mm_cache, mm);
+}
+
+static int copy_mm(unsigned long clone_flags, int nr, struct task_struct * p)
+{
+	struct mm_struct * mm;
+
+	if (clone_flags & CLONE_VM) {
+		current->mm->users++;
+		current->mm->count++;
+		return 0;
+	}
+	if (!(mm = kmem_cache_alloc(&mm_cache)))
+		return -ENOMEM;
+	*mm = *current->mm;
+	mm->users = mm->count = 1;
+	p->mm = mm;
+	if (copy_mem(nr, p)) {
+		kmem_cache_free(&mm_cache, mm);
+		return -ENOMEM;
+	}
+	mm->pg_dir = p->tss.cr3;
+	if (copy_mmap(p)) {
+		free_page_tables(task_pg_dir(p),p->start_code,get_limit(0x17));
+		free_page(p->tss.cr3);
+		kmem_cache_free(&mm_cache, mm);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
 /*
  *  Ok, this is the main fork-routine. It copies the system process
  * information (task[nr]) and sets up the necessary registers. It
  * also copies the data segment in it's entirety.
  */
-int copy_process(int nr, long ebp, long edi, long esi, long gs, long none,
+int copy_process(unsigned long clone_flags, long newsp,
+		int nr, long ebp, long edi, long esi, long gs, long none,
 		        long ebx, long ecx, long edx,
 		        long fs, long es, long ds,
 		        long eip, long cs, long eflags, long esp, long ss)
 {
 	struct task_struct *p;
+	struct files_struct *files = NULL;
+	struct fs_struct *fs_info = NULL;
 	int i;
 	struct file *f;
+	long * stack;
 
 	p = (struct task_struct *) get_free_page();
 	if (!p)
 		return -EAGAIN;
+	if (!(clone_flags & CLONE_FILES) &&
+	    !(files = kmem_cache_alloc(&files_cache)))
+		goto bad_fork;
+	if (!(clone_flags & CLONE_FS) &&
+	    !(fs_info = kmem_cache_alloc(&fs_cache)))
+		goto bad_fork;
 	task[nr] = p;
 	
 	// NOTE!: the following statement now work with gcc 4.3.2 now, and you
@@ -96,53 +201,86 @@ int copy_process(int nr, long ebp, long edi, long esi, long gs, long none,
 	p->utime = p->stime = 0;
 	p->cutime = p->cstime = 0;
 	p->start_time = jiffies;
-	p->tss.back_link = 0;
+#ifdef SYSCALL_STATS
+	p->sc_stat = NULL;
+#endif
+/*
+ * The child starts in ret_from_fork, on a kernel stack that looks as if
+ * it had made the system call itself and got 0 back from it.
+ */
+	if (newsp)
+		esp = newsp;
+	stack = (long *) (PAGE_SIZE + (long) p);
+	*--stack = ss & 0xffff;
+	*--stack = esp;
+	*--stack = eflags;
+	*--stack = cs & 0xffff;
+	*--stack = eip;
+	*--stack = ds & 0xffff;
+	*--stack = es & 0xffff;
+	*--stack = fs & 0xffff;
+	*--stack = edx;
+	*--stack = ecx;
+	*--stack = ebx;
+	*--stack = 0;			/* eax */
+	*--stack = esi;
+	*--stack = edi;
+	*--stack = ebp;
 	p->tss.esp0 = PAGE_SIZE + (long) p;
-	p->tss.ss0 = 0x10;
-	p->tss.eip = eip;
-	p->tss.eflags = eflags;
-	p->tss.eax = 0;
-	p->tss.ecx = ecx;
-	p->tss.edx = edx;
-	p->tss.ebx = ebx;
-	p->tss.esp = esp;
-	p->tss.ebp = ebp;
-	p->tss.esi = esi;
-	p->tss.edi = edi;
-	p->tss.es = es & 0xffff;
-	p->tss.cs = cs & 0xffff;
-	p->tss.ss = ss & 0xffff;
-	p->tss.ds = ds & 0xffff;
-	p->tss.fs = fs & 0xffff;
+	p->tss.esp = (long) stack;
+	p->tss.eip = (long) ret_from_fork;
+	p->tss.fs = 0x17;
 	p->tss.gs = gs & 0xffff;
 	p->tss.ldt = _LDT(nr);
-	p->tss.trace_bitmap = 0x80000000;
-	if (last_task_used_math == current)
-		__asm__("clts ; fnsave %0"::"m" (p->tss.i387));
-	if (copy_mem(nr, p)) {
+	if (last_task_used_math == current) {
+		__asm__("clts");
+		save_math_state(p);
+	}
+	if (copy_mm(clone_flags, nr, p)) {
 		task[nr] = NULL;
-		free_page((long) p);
-		return -EAGAIN;
+		goto bad_fork;
 	}
 
-    // 子进程继承父进程的文件描述符、pwd、root 和 executable
-	for (i = 0; i < NR_OPEN; i++) {
-		if ((f = p->filp[i]))
-			f->f_count++;
-	}
-	if (current->pwd)
-		current->pwd->i_count++;
-	if (current->root)
-		current->root->i_count++;
+    // 子进程继承父进程的文件描述符、pwd、root 和 executable，
+    // clone() 的标志要求共享的则只增加引用计数
+	if (files) {
+		*files = *current->files;
+		files->count = 1;
+		for (i = 0; i < NR_OPEN; i++) {
+			if ((f = files->fd[i]))
+				f->f_count++;
+		}
+		p->files = files;
+	} else
+		current->files->count++;
+	if (fs_info) {
+		*fs_info = *current->fs;
+		fs_info->count = 1;
+		if (fs_info->pwd)
+			fs_info->pwd->i_count++;
+		if (fs_info->root)
+			fs_info->root->i_count++;
+		p->fs = fs_info;
+	} else
+		current->fs->count++;
 	if (current->executable)
 		current->executable->i_count++;
 	
-    set_tss_desc(gdt + (nr << 1) + FIRST_TSS_ENTRY, &(p->tss));
 	set_ldt_desc(gdt + (nr << 1) + FIRST_LDT_ENTRY, &(p->ldt));
+	p->p_pptr = current;
+	link_task(p);
 	
     p->state = TASK_RUNNING;	/* do this last, just in case */
 	
     return last_pid;
+
+bad_fork:
+	if (files)
+		kmem_cache_free(&files_cache, files);
+	if (fs_info)
+		kmem_cache_free(&fs_cache, fs_info);
+	free_page((long) p);
+	return -EAGAIN;
 }
 
 int find_empty_process(void)
@@ -153,10 +291,8 @@ int find_empty_process(void)
 repeat:
     if ((++last_pid) < 0) 
         last_pid = 1;
-    for (i = 0; i < NR_TASKS; i++) {
-        if (task[i] && task[i]->pid == last_pid) 
-            goto repeat;
-    }
+    if (find_task_by_pid(last_pid))
+        goto repeat;
 
     // 遍历所有任务，找到空闲任务
     for (i = 1; i < NR_TASKS; i++) {
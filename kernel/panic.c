@@ -41,6 +41,9 @@ void panic(const char * s)
         sys_sync();
     }
 
+    // 把日志中尚未输出的内容写到控制台
+    console_drain();
+
     // 进入无限循环，使系统挂起
     for (;;);
 }
@@ -0,0 +1,132 @@
+/*
+ *  linux/kernel/pid.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * The relations between tasks: the pid, process group and session
+ * hashes, and the child lists. Every task but task 0 is on them from the
+ * end of fork() until release(). A parent reaches its children through
+ * p_cptr and then the p_osptr of each child, youngest first; p_pptr is
+ * the parent, or init once the real one has exited.
+ *
+ * tty_intr() walks a process group from the keyboard interrupt, so the
+ * hashes are only changed with interrupts off. The child lists are only
+ * used by tasks in the kernel and need no lock.
+ */
+
+#include <signal.h>
+
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+
+struct task_struct * pid_hash[3][PIDHASH_SZ];
+static spinlock_t pid_hash_lock = SPIN_LOCK_UNLOCKED;
+
+static void attach_pid(struct task_struct * p, int type)
+{
+	struct task_struct ** head;
+
+	head = pid_hash[type] + pid_hashfn(task_pid_nr(p,type));
+	if ((p->pid_next[type] = *head) != NULL)
+		(*head)->pid_pprev[type] = &p->pid_next[type];
+	*head = p;
+	p->pid_pprev[type] = head;
+}
+
+static void detach_pid(struct task_struct * p, int type)
+{
+	if (p->pid_next[type])
+		p->pid_next[type]->pid_pprev[type] = p->pid_pprev[type];
+	*p->pid_pprev[type] = p->pid_next[type];
+}
+
+struct task_struct * find_task_by_pid(long pid)
+{
+	struct task_struct * p;
+
+	for_each_task_pid(pid,PIDTYPE_PID,p)
+		return p;
+	return NULL;
+}
+
+/* only the process group and the session of a task ever change */
+void change_pid(struct task_struct * p, int type, long nr)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pid_hash_lock,flags);
+	detach_pid(p,type);
+	if (type == PIDTYPE_PGID)
+		p->pgrp = nr;
+	else
+		p->session = nr;
+	attach_pid(p,type);
+	spin_unlock_irqrestore(&pid_hash_lock,flags);
+}
+
+static inline void set_links(struct task_struct * p)
+{
+	p->p_ysptr = NULL;
+	if ((p->p_osptr = p->p_pptr->p_cptr) != NULL)
+		p->p_osptr->p_ysptr = p;
+	p->p_pptr->p_cptr = p;
+}
+
+static inline void remove_links(struct task_struct * p)
+{
+	if (p->p_osptr)
+		p->p_osptr->p_ysptr = p->p_ysptr;
+	if (p->p_ysptr)
+		p->p_ysptr->p_osptr = p->p_osptr;
+	else
+		p->p_pptr->p_cptr = p->p_osptr;
+}
+
+/* fork() calls this last, with p_pptr set to the parent */
+void link_task(struct task_struct * p)
+{
+	unsigned long flags;
+	int type;
+
+	p->p_cptr = NULL;
+	set_links(p);
+	spin_lock_irqsave(&pid_hash_lock,flags);
+	for (type = 0 ; type < 3 ; type++)
+		attach_pid(p,type);
+	spin_unlock_irqrestore(&pid_hash_lock,flags);
+}
+
+void unlink_task(struct task_struct * p)
+{
+	unsigned long flags;
+	int type;
+
+	remove_links(p);
+	spin_lock_irqsave(&pid_hash_lock,flags);
+	for (type = 0 ; type < 3 ; type++)
+		detach_pid(p,type);
+	spin_unlock_irqrestore(&pid_hash_lock,flags);
+}
+
+/*
+ * The children of an exiting task go to init. Zombies among them are
+ * init's to wait for now, so it gets a SIGCHLD for them. If init itself
+ * exits, there is nobody to give them to: they stay where they are.
+ */
+void reparent_children(struct task_struct * p)
+{
+	struct task_struct * child;
+
+	if (p == task[1])
+		return;
+	while ((child = p->p_cptr) != NULL) {
+		remove_links(child);
+		child->p_pptr = task[1];
+		child->father = 1;
+		set_links(child);
+		if (child->state == TASK_ZOMBIE)
+			task[1]->signal |= 1<<(SIGCHLD-1);
+	}
+}
@@ -5,57 +5,203 @@
  */
 
 /*
- * When in kernel-mode, we cannot use printf, as fs is liable to
- * point to 'interesting' things. Make a printf with fs-saving, and
- * all is well.
+ * printk() no longer writes to the console itself: it puts the text in
+ * the log ring (see <linux/dmesg.h>) and returns. A record is claimed
+ * with one locked xadd on log_seq (with cli on a 386), so printk()
+ * takes no lock and may interrupt itself. The record's seq is written last; a reader that
+ * finds another seq there, before or after copying, knows the record
+ * is still being written or has been reused.
+ *
+ * console_drain() writes out what is new. schedule() calls it, so the
+ * console is written between tasks instead of in the middle of what
+ * logged, and panic() calls it before halting.
  */
 #include <stdarg.h>
 #include <stddef.h>
+#include <errno.h>
+#include <sys/time.h>
 
+#include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/tty.h>
+#include <linux/timepage.h>
+#include <linux/spinlock.h>
+#include <linux/dmesg.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+#include <asm/cpufeature.h>
+
+#define LOG_LINE 256		/* longer printk()s are cut short */
+
+static struct log_record log_buf[LOG_RECORDS];
+static unsigned long log_seq = 0;	/* next record to claim */
+static unsigned long log_first = 0;	/* dmesg(-1) cleared up to here */
+static unsigned long console_seq = 0;	/* next record for the console */
+static spinlock_t console_lock = SPIN_LOCK_UNLOCKED;
+
+extern int vsnprintf(char * buf, int size, const char * fmt, va_list args);
+
+/* the 386 has no xadd, but it has no second cpu either */
+static inline unsigned long log_claim(void)
+{
+	unsigned long seq, flags;
+
+	if (x86 > 3) {
+		__asm__ __volatile__("lock ; xaddl %0,%1"
+			:"=r" (seq),"+m" (log_seq)
+			:"0" (1):"memory");
+		return seq;
+	}
+	save_flags(flags);
+	cli();
+	seq = log_seq++;
+	restore_flags(flags);
+	return seq;
+}
+
+static void log_store(const char * s, int len)
+{
+	struct log_record * r;
+	struct timeval tv;
+	unsigned long seq;
+	int i;
+
+	if (time_page_read(&time_page.p, &tv, 0)) {
+		tv.tv_sec = jiffies / HZ;
+		tv.tv_usec = (jiffies % HZ) * (1000000/HZ);
+	}
+	while (len > 0) {
+		seq = log_claim();
+		r = log_buf + (seq & (LOG_RECORDS-1));
+		r->seq = 0;
+		__asm__ __volatile__("":::"memory");
+		r->sec = tv.tv_sec;
+		r->usec = tv.tv_usec;
+		r->len = len > LOG_TEXT ? LOG_TEXT : len;
+		for (i=0 ; i<r->len ; i++)
+			r->text[i] = *s++;
+		len -= r->len;
+		__asm__ __volatile__("":::"memory");
+		r->seq = seq + 1;
+	}
+}
+
+/*
+ * Copy record seq to 'copy', or the oldest one left if seq has been
+ * overwritten already. Returns the seq copied, or -1 if seq is still
+ * being written or not logged yet.
+ */
+static long log_read(unsigned long seq, struct log_record * copy)
+{
+	struct log_record * r;
+	unsigned long head;
+	int i;
 
-static char buf[1024];
+	for (;;) {
+		head = log_seq;
+		if (seq >= head)
+			return -1;
+		if (head - seq > LOG_RECORDS)
+			seq = head - LOG_RECORDS;
+		r = log_buf + (seq & (LOG_RECORDS-1));
+		if (r->seq == seq + 1) {
+			for (i=0 ; i<sizeof *r ; i++)
+				((char *) copy)[i] = ((char *) r)[i];
+			__asm__ __volatile__("":::"memory");
+			if (r->seq == seq + 1) {
+				copy->seq = seq;
+				return seq;
+			}
+		}
+		if (log_seq - seq <= LOG_RECORDS)
+			return -1;
+	}
+}
+
+/*
+ * The console is written directly, not through tty_write(): that may
+ * sleep on a full queue or stop for a signal of whatever task runs.
+ * con_write() always empties the queue.
+ */
+static void console_write(const char * s, int len)
+{
+	struct tty_struct * tty = tty_table;
+
+	while (len > 0) {
+		while (len > 0 && !FULL(tty->write_q)) {
+			PUTCH(*s++,tty->write_q);
+			len--;
+		}
+		tty->write(tty);
+	}
+}
+
+void console_drain(void)
+{
+	struct log_record r;
+	long seq;
 
-extern int vsprintf(char * buf, const char * fmt, va_list args);
+	if (!spin_trylock(&console_lock))
+		return;
+	while ((seq = log_read(console_seq, &r)) >= 0) {
+		if (seq != console_seq)
+			console_write("<log overrun>\n\r", 15);
+		console_write(r.text, r.len);
+		console_seq = seq + 1;
+	}
+	spin_unlock(&console_lock);
+}
 
 /**
  * @brief 内核模式下的格式化输出函数
- * 
+ *
  * 该函数类似于标准库的 printf 函数，用于在内核模式下进行格式化输出。
- * 由于内核模式下不能直接使用 printf，此函数先将格式化后的字符串存入缓冲区，
- * 然后通过调用 tty_write 函数将缓冲区内容输出到终端。
- * 
+ * 格式化后的字符串只记入内核日志环形缓冲区，不直接写控制台，
+ * 由 console_drain() 在任务切换时输出，因此可以在中断中调用。
+ *
  * @param fmt 格式化字符串，与 printf 函数的第一个参数类似
  * @param ... 可变参数列表，对应格式化字符串中的占位符
  * @return int 输出字符串的长度
  */
 int printk(const char *fmt, ...)
 {
+    char buf[LOG_LINE];
     va_list args;
     int i;
 
     // 初始化可变参数列表
     va_start(args, fmt);
-    // 使用 vsprintf 将格式化后的字符串存入 buf 缓冲区
-    i = vsprintf(buf, fmt, args);
+    // 使用 vsnprintf 将格式化后的字符串存入栈上的 buf 缓冲区，超长部分截掉
+    i = vsnprintf(buf, LOG_LINE, fmt, args);
     // 结束可变参数列表的使用
     va_end(args);
+    if (i > LOG_LINE - 1)
+        i = LOG_LINE - 1;
 
-    // 使用内联汇编调用 tty_write 函数将缓冲区内容输出到终端
-    __asm__ (
-        "push %%fs\n\t"
-        "push %%ds\n\t"
-        "pop %%fs\n\t"
-        "pushl %0\n\t"
-        "pushl $buf\n\t"
-        "pushl $0\n\t"
-        "call tty_write\n\t"
-        "addl $8,%%esp\n\t"
-        "popl %0\n\t"
-        "pop %%fs"
-        ::"r" (i)
-        :"ax", "cx", "dx"
-    );
+    // 记入日志环形缓冲区
+    log_store(buf, i);
 
     return i;
 }
+
+int sys_dmesg(long seq, struct log_record * buf)
+{
+	struct log_record copy;
+	int i;
+
+	if (seq < 0) {
+		if (!suser())
+			return -EPERM;
+		log_first = log_seq;
+		return 0;
+	}
+	if (seq < log_first)
+		seq = log_first;
+	if ((seq = log_read(seq, &copy)) < 0)
+		return -ENOENT;
+	if (verify_area(buf,sizeof *buf))
+		return -EFAULT;
+	for (i=0 ; i<sizeof *buf ; i++)
+		put_fs_byte(((char *) &copy)[i],i+(char *) buf);
+	return seq;
+}
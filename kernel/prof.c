@@ -0,0 +1,132 @@
+/*
+ *  linux/kernel/prof.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 'prof.c' implements the kernel-wide statistical profiler behind the
+ * prof() system call. do_timer() hands us the eip it interrupted, and
+ * we count it in a histogram that is read out with prof(PROF_READ).
+ * tools/readprofile turns the kernel part into per-function counts
+ * using System.map.
+ */
+#include <errno.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/prof.h>
+#include <asm/segment.h>
+
+extern int etext;
+
+#define BUCKETS_PER_PAGE (PAGE_SIZE/sizeof(unsigned long))
+
+int prof_on = 0;
+static struct prof_header prof;
+static unsigned long * prof_page[PROF_MAX_PAGES];
+
+#define bucket(nr) prof_page[(nr)/BUCKETS_PER_PAGE][(nr)%BUCKETS_PER_PAGE]
+
+/*
+ * Called from the timer interrupt when prof_on is set. Task 0 runs
+ * main() in user mode with a base of 0, so its eip is a kernel address
+ * and the idle loop is counted against the kernel.
+ */
+void do_prof(long cpl, unsigned long eip)
+{
+	unsigned long nr = eip >> prof.shift;
+
+	if (!cpl || current == FIRST_TASK) {
+		prof.kernel_ticks++;
+		if (nr >= prof.kernel_buckets)
+			nr = prof.kernel_buckets-1;
+		bucket(nr)++;
+		return;
+	}
+	prof.user_ticks++;
+	if (nr >= prof.user_buckets) {
+		prof.lost_ticks++;
+		return;
+	}
+	bucket(prof.kernel_buckets+nr)++;
+}
+
+static void prof_free(void)
+{
+	int i;
+
+	prof_on = 0;
+	for (i=0 ; i<PROF_MAX_PAGES ; i++)
+		if (prof_page[i]) {
+			free_page((unsigned long) prof_page[i]);
+			prof_page[i] = NULL;
+		}
+	prof.kernel_buckets = prof.user_buckets = 0;
+}
+
+static int prof_start(unsigned long shift, unsigned long user_span)
+{
+	unsigned long i, nr;
+
+	if (shift < 2 || shift > 16)
+		return -EINVAL;
+	prof_free();
+	nr = (((unsigned long) &etext) >> shift) + 1;
+	nr += (user_span + (1<<shift) - 1) >> shift;
+	nr = (nr + BUCKETS_PER_PAGE - 1) / BUCKETS_PER_PAGE;
+	if (nr > PROF_MAX_PAGES)
+		return -EINVAL;
+	for (i=0 ; i<nr ; i++)
+		if (!(prof_page[i] = (unsigned long *) get_free_page())) {
+			prof_free();
+			return -ENOMEM;
+		}
+	prof.shift = shift;
+	prof.kernel_buckets = (((unsigned long) &etext) >> shift) + 1;
+	prof.user_buckets = (user_span + (1<<shift) - 1) >> shift;
+	prof.kernel_ticks = prof.user_ticks = prof.lost_ticks = 0;
+	prof_on = 1;
+	return 0;
+}
+
+static int prof_read(char * buf, unsigned long size)
+{
+	unsigned long i, nr;
+	int count;
+
+	if (!prof.kernel_buckets)
+		return 0;
+	if (size < sizeof prof)
+		return -EINVAL;
+	if (verify_area(buf,size))
+		return -EFAULT;
+	for (i=0 ; i<sizeof prof ; i++)
+		put_fs_byte(((char *) &prof)[i],buf++);
+	count = sizeof prof;
+	size -= sizeof prof;
+	nr = prof.kernel_buckets + prof.user_buckets;
+	for (i=0 ; i<nr && size>=4 ; i++,size -= 4,count += 4,buf += 4)
+		put_fs_long(bucket(i),(unsigned long *) buf);
+	return count;
+}
+
+int sys_prof(int cmd, unsigned long arg, unsigned long arg2)
+{
+	if (cmd != PROF_READ && !suser())
+		return -EPERM;
+	switch (cmd) {
+		case PROF_START:
+			return prof_start(arg,arg2);
+		case PROF_STOP:
+			prof_on = 0;
+			return 0;
+		case PROF_READ:
+			return prof_read((char *) arg,arg2);
+		case PROF_FREE:
+			prof_free();
+			return 0;
+	}
+	return -EINVAL;
+}
@@ -14,9 +14,15 @@
 #include <linux/kernel.h>
 #include <linux/sys.h>
 #include <linux/fdreg.h>
+#include <linux/timepage.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/smp.h>
 #include <asm/system.h>
 #include <asm/io.h>
 #include <asm/segment.h>
+#include <asm/cpufeature.h>
 
 #include <signal.h>
 
@@ -34,6 +40,17 @@ void show_task(int nr,struct task_struct * p)
 	printk("%d (of %d) chars free in kernel stack\n\r",i,j);
 }
 
+#ifdef LOCK_STATS
+static spinlock_t timer_lock;
+extern spinlock_t request_lock;
+
+static void show_locks(void)
+{
+	printk("contended: timer_lock %d, request_lock %d\n\r",
+		timer_lock.contended,request_lock.contended);
+}
+#endif
+
 void show_stat(void)
 {
 	int i;
@@ -41,6 +58,9 @@ void show_stat(void)
 	for (i=0;i<NR_TASKS;i++)
 		if (task[i])
 			show_task(i,task[i]);
+#ifdef LOCK_STATS
+	show_locks();
+#endif
 }
 
 #define LATCH (1193180 / HZ)        // 8253 定时器输入时钟脉冲为 1193180，1s 对应 1193180，因此 11931 对应 10ms
@@ -49,48 +69,115 @@ extern void mem_use(void);
 
 extern int timer_interrupt(void);
 extern int system_call(void);
+extern void sysenter_entry(void);
 
 union task_union {
 	struct task_struct task;
 	char stack[PAGE_SIZE];
 };
 
+struct mm_struct init_mm = { 1, 1, (unsigned long) pg_dir, 0, NULL };
+struct fs_struct init_fs = INIT_FS;
+struct files_struct init_files = INIT_FILES;
+
 static union task_union init_task = {INIT_TASK,};
 
 long volatile jiffies = 0;
 long startup_time=0;
+union time_page_union time_page __attribute__((aligned(PAGE_SIZE)));
 struct task_struct *current = &(init_task.task);
 struct task_struct *last_task_used_math = NULL;
 
 struct task_struct * task[NR_TASKS] = {&(init_task.task), };
 
+/* the tss of every cpu, only esp0 of it changes */
+struct tss_struct cpu_tss[NR_CPUS];
+struct sysenter_stack sysenter_stack[NR_CPUS];
+
 long user_stack [ PAGE_SIZE>>2 ] ;
 
 struct {
 	long * a;
 	short b;
 	} stack_start = { & user_stack [PAGE_SIZE>>2] , 0x10 };     // 指向 user_stack 数组的末尾，段选择子为 0b00010 0 00，gdt 数据段 0级别
+/*
+ * The math state a task starts with when fxsave is used: fninit would
+ * leave the SSE registers and mxcsr of the last task in place.
+ */
+static struct i387_fxsave_struct init_fxsave = { 0x37f, 0, 0, 0,
+	0, 0, 0, 0, 0x1f80, };
+
+/*
+ * save_math_state() saves the math state in 'p'. Unlike fnsave alone,
+ * it leaves the co-processor as it was. TS must be clear.
+ */
+void save_math_state(struct task_struct * p)
+{
+	if (cpu_has(X86_FEATURE_FXSR))
+		__asm__("fxsave %0"::"m" (p->tss.i387.fx));
+	else
+		__asm__("fnsave %0 ; frstor %0"::"m" (p->tss.i387.soft));
+}
+
 /*
  *  'math_state_restore()' saves the current math information in the
- * old math state array, and gets the new ones from the current task
+ * old math state array, and gets the new ones from the current task.
+ * With FXSR the SSE registers go along.
  */
 void math_state_restore()
 {
+	int fxsr = cpu_has(X86_FEATURE_FXSR);
+
 	if (last_task_used_math == current)
 		return;
 	__asm__("fwait");
 	if (last_task_used_math) {
-		__asm__("fnsave %0"::"m" (last_task_used_math->tss.i387));
+		if (fxsr)
+			__asm__("fxsave %0"::"m" (last_task_used_math->tss.i387.fx));
+		else
+			__asm__("fnsave %0"::"m" (last_task_used_math->tss.i387.soft));
 	}
 	last_task_used_math=current;
 	if (current->used_math) {
-		__asm__("frstor %0"::"m" (current->tss.i387));
+		if (fxsr)
+			__asm__("fxrstor %0"::"m" (current->tss.i387.fx));
+		else
+			__asm__("frstor %0"::"m" (current->tss.i387.soft));
 	} else {
-		__asm__("fninit"::);
+		if (fxsr)
+			__asm__("fxrstor %0"::"m" (init_fxsave));
+		else
+			__asm__("fninit"::);
 		current->used_math=1;
 	}
 }
 
+/*
+ * __switch_to() is jumped to by switch_to(), already on the stack of
+ * 'next', with the address 'next' resumes at on top. It changes what
+ * the hardware task switch used to: the kernel stack for traps, the
+ * page directory, the ldt and the user %fs and %gs. The TS-flag is set
+ * unless 'next' was the last to use the math co-processor.
+ */
+void __attribute__((regparm(2))) __switch_to(struct task_struct * prev,
+	struct task_struct * next)
+{
+	cpu_tss[0].esp0 = sysenter_stack[0].esp0 = next->tss.esp0;
+	if (next->tss.cr3 != prev->tss.cr3)
+		__asm__ __volatile__("movl %0,%%cr3"::"r" (next->tss.cr3));
+	__asm__ __volatile__("lldt %%ax"::"a" (next->tss.ldt));
+	__asm__ __volatile__("movw %%fs,%0 ; movw %%gs,%1"
+		:"=m" (prev->tss.fs),"=m" (prev->tss.gs));
+	__asm__ __volatile__("movw %0,%%fs ; movw %1,%%gs"
+		::"m" (next->tss.fs),"m" (next->tss.gs));
+	if (next == last_task_used_math)
+		__asm__ __volatile__("clts");
+	else
+		__asm__ __volatile__("movl %%cr0,%%eax ; orl $8,%%eax ; "
+			"movl %%eax,%%cr0":::"ax");
+	current = next;
+}
+
 /*
  *  'schedule()' is the scheduler function. This is GOOD CODE! There
  * probably won't be any reason to change this, as it should work well
@@ -106,6 +193,8 @@ void schedule(void)
 	int i, next, c;
 	struct task_struct **p;
 
+/* printk() only logs: the console is written here, between tasks */
+	console_drain();
 	for(p = &LAST_TASK; p > &FIRST_TASK; --p) {
 		if (*p) {
 			if ((*p)->alarm && (*p)->alarm < jiffies) {     // 检查任务的闹钟是否到期，alarm 表示任务到期的时钟节拍
@@ -200,6 +289,56 @@ void wake_up(struct task_struct **p)
 	}
 }
 
+/*
+ * The slow paths of mutex_lock() and mutex_wait(). Interrupts are off
+ * from the test to sleep_on(), so that an unlock from an interrupt
+ * can't slip in between and leave us asleep on a free mutex.
+ */
+void __mutex_lock(struct mutex * m)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	while (!mutex_trylock(m)) {
+#ifdef LOCK_STATS
+		m->contended++;
+#endif
+		sleep_on(&m->wait);
+	}
+	restore_flags(flags);
+}
+
+void __mutex_wait(struct mutex * m)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	while (m->locked) {
+#ifdef LOCK_STATS
+		m->contended++;
+#endif
+		sleep_on(&m->wait);
+	}
+	restore_flags(flags);
+}
+
+void mutex_unlock(struct mutex * m)
+{
+	m->locked = 0;
+	wake_up(&m->wait);
+}
+
+void mutex_init(struct mutex * m)
+{
+	m->locked = 0;
+	m->wait = NULL;
+#ifdef LOCK_STATS
+	m->contended = 0;
+#endif
+}
+
 /*
  * OK, here are some floppy things that shouldn't be in the kernel
  * proper. They are here because the floppy needs a timer, and this
@@ -268,29 +407,81 @@ void do_floppy_timer(void)
 	}
 }
 
-#define TIME_REQUESTS 64
-
 static struct timer_list {
 	long jiffies;
 	void (*fn)();
 	struct timer_list * next;
-} timer_list[TIME_REQUESTS], * next_timer = NULL;
+} * next_timer = NULL;
+
+static struct kmem_cache timer_cache =
+	KMEM_CACHE("timer", struct timer_list, NULL);
+
+/*
+ * The floppy driver adds timers from its interrupt handler, where the
+ * cache must not grow: get_free_page() may shrink the buffer cache
+ * under a process. Callers with interrupts off only take timers from
+ * this reserve, the size of the old static table; the others fall back
+ * on it when the cache can't grow.
+ */
+#define TIME_REQUESTS 64
+
+static struct timer_list timer_reserve[TIME_REQUESTS];
+static struct timer_list * free_timer = NULL;
+
+#define reserve_timer(p) ((p) >= timer_reserve && \
+	(p) < timer_reserve + TIME_REQUESTS)
+
+/* do_timer() takes it with interrupts off already */
+static spinlock_t timer_lock = SPIN_LOCK_UNLOCKED;
+
+static struct timer_list * alloc_timer(void)
+{
+	struct timer_list * p = NULL;
+	unsigned long flags;
+
+	save_flags(flags);
+	if (flags & 0x200)
+		p = kmem_cache_alloc(&timer_cache);
+	if (!p) {
+		spin_lock_irqsave(&timer_lock,flags);
+		if ((p = free_timer))
+			free_timer = p->next;
+		spin_unlock_irqrestore(&timer_lock,flags);
+	}
+	return p;
+}
+
+static void release_timer(struct timer_list * p)
+{
+	unsigned long flags;
+
+	if (!reserve_timer(p)) {
+		kmem_cache_free(&timer_cache,p);
+		return;
+	}
+	spin_lock_irqsave(&timer_lock,flags);
+	p->next = free_timer;
+	free_timer = p;
+	spin_unlock_irqrestore(&timer_lock,flags);
+}
 
 void add_timer(long jiffies, void (*fn)(void))
 {
 	struct timer_list * p;
+	unsigned long flags;
 
 	if (!fn)
 		return;
-	cli();
-	if (jiffies <= 0)
+	if (jiffies <= 0) {
+/* timer functions expect to run with interrupts off */
+		save_flags(flags);
+		cli();
 		(fn)();
-	else {
-		for (p = timer_list ; p < timer_list + TIME_REQUESTS ; p++)
-			if (!p->fn)
-				break;
-		if (p >= timer_list + TIME_REQUESTS)
+		restore_flags(flags);
+	} else {
+		if (!(p = alloc_timer()))
 			panic("No more time requests free");
+		spin_lock_irqsave(&timer_lock,flags);
 		p->fn = fn;
 		p->jiffies = jiffies;
 		p->next = next_timer;
@@ -305,14 +496,76 @@ void add_timer(long jiffies, void (*fn)(void))
 			p->next->jiffies = jiffies;
 			p = p->next;
 		}
+		spin_unlock_irqrestore(&timer_lock,flags);
 	}
+}
+
+/*
+ * The time page is rewritten on every tick. Interrupts are off in
+ * the timer interrupt, so only readers ever see 'seq' odd.
+ */
+static inline void update_time_page(void)
+{
+	unsigned long lo, hi;
+
+	time_page.p.seq++;
+	if (time_page.p.tsc_quotient) {
+		rdtsc(lo,hi);
+		time_page.p.tick_tsc = lo;
+	}
+	time_page.p.jiffies = jiffies;
+	time_page.p.startup_time = startup_time;
+	time_page.p.seq++;
+}
+
+/*
+ * do_gettimeofday() uses the TSC through the time page if it can, and
+ * otherwise latches the count of timer 0 to find out how far we are
+ * into the current tick.
+ */
+void do_gettimeofday(struct timeval * tv, int realtime)
+{
+	unsigned long count;
+	long ticks;
+
+	if (!time_page_read(&time_page.p, tv, realtime))
+		return;
+	cli();
+	ticks = jiffies;
+	outb_p(0x00, 0x43);
+	count = inb_p(0x40);
+	count |= inb(0x40) << 8;
 	sti();
+	count = ((LATCH-1) - count) * (1000000/HZ) / LATCH;
+	tv->tv_sec = (realtime ? startup_time : 0) + ticks / HZ;
+	tv->tv_usec = (ticks % HZ) * (1000000/HZ) + count;
 }
 
-void do_timer(long cpl)
+/*
+ * usec_clock() is a cheap free-running microsecond counter, good for
+ * timing intervals even from interrupts. Without a TSC it only has
+ * the resolution of a tick.
+ */
+unsigned long usec_clock(void)
+{
+	struct timeval tv;
+
+	if (time_page_read(&time_page.p, &tv, 0))
+		return jiffies * (1000000/HZ);
+	return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+void do_timer(long cpl, unsigned long eip)
 {
 	extern int beepcount;
 	extern void sysbeepstop(void);
+	extern int prof_on;
+	extern void do_prof(long cpl, unsigned long eip);
+
+	update_time_page();
+
+	if (prof_on)
+		do_prof(cpl, eip);
 
 	if (beepcount)
 		if (!--beepcount)
@@ -323,17 +576,22 @@ void do_timer(long cpl)
 	else
 		current->stime++;               // 内核态程序运行时间
 
+	spin_lock(&timer_lock);
 	if (next_timer) {
 		next_timer->jiffies--;
 		while (next_timer && next_timer->jiffies <= 0) {
+			struct timer_list * p = next_timer;
 			void (*fn)(void);
 			
-			fn = next_timer->fn;
-			next_timer->fn = NULL;
-			next_timer = next_timer->next;
+			fn = p->fn;
+			next_timer = p->next;
+			spin_unlock(&timer_lock);	/* fn may add_timer() */
+			release_timer(p);
 			(fn)();
+			spin_lock(&timer_lock);
 		}
 	}
+	spin_unlock(&timer_lock);
 
 	if (current_DOR & 0xf0)
 		do_floppy_timer();
@@ -393,6 +651,39 @@ int sys_nice(long increment)
 	return 0;
 }
 
+/*
+ * calibrate_tsc() counts TSC cycles while timer 2 counts down one tick,
+ * with the speaker gated off. The result is kept as the quotient the
+ * time page readers multiply with, so they need no divide.
+ */
+static void calibrate_tsc(void)
+{
+	unsigned long start, end, hi;
+	unsigned char old61;
+
+	time_page.p.hz = HZ;
+	time_page.p.usec_per_tick = 1000000/HZ;
+	if (!cpu_has(X86_FEATURE_TSC))
+		return;
+	old61 = inb(0x61);
+	outb((old61 & ~0x02) | 0x01, 0x61);
+	outb(0xb0, 0x43);		/* timer 2, lsb/msb, mode 0 */
+	outb(LATCH & 0xff, 0x42);
+	outb(LATCH >> 8, 0x42);
+	rdtsc(start,hi);
+	while (!(inb(0x61) & 0x20))
+		/* nothing */;
+	rdtsc(end,hi);
+	outb(old61, 0x61);
+	end -= start;
+	if (end <= 1000000/HZ)
+		return;
+	__asm__("divl %2"
+		:"=a" (time_page.p.tsc_quotient),"=d" (hi)
+		:"r" (end),"0" (0),"1" (1000000/HZ));
+	printk("TSC: %d cycles per tick\n\r", end);
+}
+
 /**
  * @brief 初始化系统调度相关设置
  * 
@@ -409,8 +700,7 @@ void sched_init(void)
     if (sizeof(struct sigaction) != 16)
         panic("Struct sigaction MUST be 16 bytes");
 
-    // 设置第一个任务的 TSS 和 LDT 描述符（位于 gdt 区域）
-    set_tss_desc(gdt + FIRST_TSS_ENTRY, &(init_task.task.tss));
+    // 设置第一个任务的 LDT 描述符（位于 gdt 区域）
     set_ldt_desc(gdt + FIRST_LDT_ENTRY, &(init_task.task.ldt));
 
     // 指向 GDT 表中第一个任务 TSS 和 LDT 描述符之后的位置
@@ -427,6 +717,20 @@ void sched_init(void)
         p++;
     }
 
+    // 每个 CPU 一个 TSS，放在 TSSn 表项里；任务切换只改其中的 esp0
+    for (i = 0; i < NR_CPUS; i++) {
+        cpu_tss[i].ss0 = 0x10;
+        cpu_tss[i].trace_bitmap = 0x80000000;
+        set_tss_desc(gdt + FIRST_TSS_ENTRY + (i << 1), cpu_tss + i);
+    }
+    cpu_tss[0].esp0 = sysenter_stack[0].esp0 = init_task.task.tss.esp0;
+
+    // 中断中使用的定时器预留表，串成空闲链表
+    for (i = 0; i < TIME_REQUESTS; i++) {
+        timer_reserve[i].next = free_timer;
+        free_timer = timer_reserve + i;
+    }
+
     /* 清除 NT 标志位，避免后续出现问题 */
     __asm__("pushfl ; andl $0xffffbfff,(%esp) ; popfl");
 
@@ -449,4 +753,9 @@ void sched_init(void)
 
     // 设置 0x80 号系统调用门，指向系统调用处理函数
     set_system_gate(0x80, &system_call);
+    // 支持 SEP 的 CPU 再开一个 sysenter 入口，落在自己的小栈上，从中取出 esp0
+    time_page.p.sysenter = sysenter_init(
+        (unsigned long) &sysenter_stack[0].esp0, sysenter_entry);
+
+    calibrate_tsc();
 }
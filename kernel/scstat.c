@@ -0,0 +1,110 @@
+/*
+ *  linux/kernel/scstat.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * 'scstat.c' keeps per-system-call counts and rdtsc cycles. system_call
+ * calls scstat_enter() just before and scstat_exit() just after the
+ * sys_* function, when SYSCALL_STATS is defined. The per-task numbers
+ * live in a page of their own, allocated on the first call a task
+ * makes and freed by release().
+ */
+#include <errno.h>
+
+#include <linux/config.h>
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/scstat.h>
+#include <asm/segment.h>
+#include <asm/cpufeature.h>
+
+#ifdef SYSCALL_STATS
+
+static struct syscall_stat syscall_stat[NR_SYSCALLS];
+
+static inline unsigned long long get_tsc(void)
+{
+	unsigned long lo, hi;
+
+	rdtsc(lo,hi);
+	return ((unsigned long long) hi << 32) | lo;
+}
+
+static inline void account(struct syscall_stat * s, unsigned long long t)
+{
+	s->count++;
+	s->cycles += t;
+	if (t > s->max)
+		s->max = t;
+}
+
+void scstat_enter(long nr)
+{
+	current->sc_nr = nr;
+	if (cpu_has(X86_FEATURE_TSC))
+		current->sc_start = get_tsc();
+}
+
+void scstat_exit(void)
+{
+	unsigned long long t = 0;
+	long nr = current->sc_nr;
+
+	if (nr < 0 || nr >= NR_SYSCALLS)
+		return;
+	if (cpu_has(X86_FEATURE_TSC))
+		t = get_tsc() - current->sc_start;
+	account(syscall_stat + nr, t);
+	if (!current->sc_stat)
+		current->sc_stat = (struct syscall_stat *) get_free_page();
+	if (current->sc_stat)
+		account(current->sc_stat + nr, t);
+}
+
+int sys_scstat(int pid, struct syscall_stat * buf, int n)
+{
+	struct syscall_stat * s = NULL;
+	struct task_struct * p;
+	int i;
+
+	if (pid < 0) {
+		if (!suser())
+			return -EPERM;
+		for (i=0 ; i<NR_SYSCALLS ; i++)
+			syscall_stat[i].count = syscall_stat[i].cycles =
+				syscall_stat[i].max = 0;
+		return 0;
+	}
+	if (!pid)
+		s = syscall_stat;
+	else {
+		if (!(p = find_task_by_pid(pid)))
+			return -ESRCH;
+/* as for kill(): only one's own tasks, unless root */
+		if (current->euid != p->euid && current->uid != p->uid &&
+		    !suser())
+			return -EPERM;
+		if (!(s = p->sc_stat))
+			return 0;
+	}
+	if (n > NR_SYSCALLS)
+		n = NR_SYSCALLS;
+	if (n <= 0)
+		return 0;
+	if (verify_area(buf,n * sizeof *buf))
+		return -EFAULT;
+	for (i=0 ; i<n*sizeof *buf ; i++)
+		put_fs_byte(((char *) s)[i],i+(char *) buf);
+	return n;
+}
+
+#else
+
+int sys_scstat(int pid, struct syscall_stat * buf, int n)
+{
+	return -ENOSYS;
+}
+
+#endif
@@ -4,6 +4,8 @@
  *  (C) 1991  Linus Torvalds
  */
 
+#include <errno.h>
+
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <asm/segment.h>
@@ -29,7 +31,6 @@ static inline void save_old(char * from,char * to)
 {
 	int i;
 
-	verify_area(to, sizeof(struct sigaction));
 	for (i=0 ; i< sizeof(struct sigaction) ; i++) {
 		put_fs_byte(*from,to);
 		from++;
@@ -67,6 +68,8 @@ int sys_sigaction(int signum, const struct sigaction * action,
 
 	if (signum<1 || signum>32 || signum==SIGKILL)
 		return -1;
+	if (oldaction && verify_area(oldaction, sizeof(struct sigaction)))
+		return -EFAULT;
 	tmp = current->sigaction[signum-1];
 	get_new((char *) action,
 		(char *) (signum-1+current->sigaction));
@@ -104,7 +107,8 @@ void do_signal(long signr,long eax, long ebx, long ecx, long edx,
 	*(&eip) = sa_handler;
 	longs = (sa->sa_flags & SA_NOMASK)?7:8;
 	*(&esp) -= longs;
-	verify_area(esp,longs*4);
+	if (verify_area(esp,longs*4))
+		do_exit(SIGSEGV);
 	tmp_esp=esp;
 	put_fs_long((long) sa->sa_restorer,tmp_esp++);
 	put_fs_long(signr,tmp_esp++);
@@ -12,6 +12,10 @@
 #include <asm/segment.h>
 #include <sys/times.h>
 #include <sys/utsname.h>
+#include <sys/time.h>
+#include <time.h>
+
+extern void do_gettimeofday(struct timeval * tv, int realtime);
 
 int sys_ftime()
 {
@@ -43,11 +47,6 @@ int sys_rename()
 	return -ENOSYS;
 }
 
-int sys_prof()
-{
-	return -ENOSYS;
-}
-
 int sys_setregid(int rgid, int egid)
 {
 	if (rgid>0) {
@@ -105,12 +104,46 @@ int sys_time(long * tloc)
 
 	i = CURRENT_TIME;
 	if (tloc) {
-		verify_area(tloc,4);
+		if (verify_area(tloc,4))
+			return -EFAULT;
 		put_fs_long(i,(unsigned long *)tloc);
 	}
 	return i;
 }
 
+int sys_gettimeofday(struct timeval * tv, struct timezone * tz)
+{
+	struct timeval ktv;
+
+	if ((tv && verify_area(tv,sizeof *tv)) ||
+	    (tz && verify_area(tz,sizeof *tz)))
+		return -EFAULT;
+	if (tv) {
+		do_gettimeofday(&ktv, 1);
+		put_fs_long(ktv.tv_sec,(unsigned long *)&tv->tv_sec);
+		put_fs_long(ktv.tv_usec,(unsigned long *)&tv->tv_usec);
+	}
+	if (tz) {
+		put_fs_long(0,(unsigned long *)&tz->tz_minuteswest);
+		put_fs_long(0,(unsigned long *)&tz->tz_dsttime);
+	}
+	return 0;
+}
+
+int sys_clock_gettime(clockid_t clk, struct timespec * tp)
+{
+	struct timeval ktv;
+
+	if (clk != CLOCK_REALTIME && clk != CLOCK_MONOTONIC)
+		return -EINVAL;
+	do_gettimeofday(&ktv, clk == CLOCK_REALTIME);
+	if (verify_area(tp,sizeof *tp))
+		return -EFAULT;
+	put_fs_long(ktv.tv_sec,(unsigned long *)&tp->tv_sec);
+	put_fs_long(ktv.tv_usec*1000,(unsigned long *)&tp->tv_nsec);
+	return 0;
+}
+
 /*
  * Unprivileged users may change the real user id to the effective uid
  * or vice versa.
@@ -156,7 +189,8 @@ int sys_stime(long * tptr)
 int sys_times(struct tms * tbuf)
 {
 	if (tbuf) {
-		verify_area(tbuf,sizeof *tbuf);
+		if (verify_area(tbuf,sizeof *tbuf))
+			return -EFAULT;
 		put_fs_long(current->utime,(unsigned long *)&tbuf->tms_utime);
 		put_fs_long(current->stime,(unsigned long *)&tbuf->tms_stime);
 		put_fs_long(current->cutime,(unsigned long *)&tbuf->tms_cutime);
@@ -165,12 +199,22 @@ int sys_times(struct tms * tbuf)
 	return jiffies;
 }
 
+/*
+ * Lowering the break frees the pages above it, so a process can give
+ * memory back. It can't go below the end of the initialised data: those
+ * pages would fault in again from the executable, without its writes.
+ */
 int sys_brk(unsigned long end_data_seg)
 {
-	if (end_data_seg >= current->end_code &&
-	    end_data_seg < current->start_stack - 16384)
-		current->brk = end_data_seg;
-	return current->brk;
+	if (end_data_seg >= current->end_data &&
+	    end_data_seg < current->start_stack - 16384 &&
+	    (!current->mm->mmap || end_data_seg <= current->mm->mmap->vm_start)) {
+		if (PAGE_ALIGN(end_data_seg) < PAGE_ALIGN(current->mm->brk))
+			zap_pages(current,NULL,PAGE_ALIGN(end_data_seg),
+				PAGE_ALIGN(current->mm->brk));
+		current->mm->brk = end_data_seg;
+	}
+	return current->mm->brk;
 }
 
 /*
@@ -180,22 +224,20 @@ int sys_brk(unsigned long end_data_seg)
  */
 int sys_setpgid(int pid, int pgid)
 {
-	int i;
+	struct task_struct * p;
 
 	if (!pid)
 		pid = current->pid;
 	if (!pgid)
 		pgid = current->pid;
-	for (i=0 ; i<NR_TASKS ; i++)
-		if (task[i] && task[i]->pid==pid) {
-			if (task[i]->leader)
-				return -EPERM;
-			if (task[i]->session != current->session)
-				return -EPERM;
-			task[i]->pgrp = pgid;
-			return 0;
-		}
-	return -ESRCH;
+	if (!(p = find_task_by_pid(pid)))
+		return -ESRCH;
+	if (p->leader)
+		return -EPERM;
+	if (p->session != current->session)
+		return -EPERM;
+	change_pid(p,PIDTYPE_PGID,pgid);
+	return 0;
 }
 
 int sys_getpgrp(void)
@@ -208,7 +250,8 @@ int sys_setsid(void)
 	if (current->leader && !suser())
 		return -EPERM;
 	current->leader = 1;
-	current->session = current->pgrp = current->pid;
+	change_pid(current,PIDTYPE_SID,current->pid);
+	change_pid(current,PIDTYPE_PGID,current->pid);
 	current->tty = -1;
 	return current->pgrp;
 }
@@ -221,7 +264,8 @@ int sys_uname(struct utsname * name)
 	int i;
 
 	if (!name) return -ERROR;
-	verify_area(name,sizeof *name);
+	if (verify_area(name,sizeof *name))
+		return -EFAULT;
 	for(i=0;i<sizeof *name;i++)
 		put_fs_byte(((char *) &thisname)[i],i+(char *) name);
 	return 0;
@@ -229,8 +273,8 @@ int sys_uname(struct utsname * name)
 
 int sys_umask(int mask)
 {
-	int old = current->umask;
+	int old = current->fs->umask;
 
-	current->umask = mask & 0777;
+	current->fs->umask = mask & 0777;
 	return (old);
 }
@@ -1,55 +1,36 @@
-/*
- *  linux/kernel/system_call.s
- *
- *  (C) 1991  Linus Torvalds
- */
-
-/*
- *  system_call.s  contains the system-call low-level handling routines.
- * This also contains the timer-interrupt handler, as some of the code is
- * the same. The hd- and flopppy-interrupts are also here.
- *
- * NOTE: This code handles signal-recognition, which happens every time
- * after a timer-interrupt and after each system call. Ordinary interrupts
- * don't handle signal-recognition, as that would clutter them up totally
- * unnecessarily.
- *
- * Stack layout in 'ret_from_system_call':
- *
- *	 0(%esp) - %eax
- *	 4(%esp) - %ebx
- *	 8(%esp) - %ecx
- *	 C(%esp) - %edx
- *	10(%esp) - %fs
- *	14(%esp) - %es
- *	18(%esp) - %ds
- *	1C(%esp) - %eip
- *	20(%esp) - %cs
- *	24(%esp) - %eflags
- *	28(%esp) - %oldesp
- *	2C(%esp) - %oldss
- */
-
-SIG_CHLD	= 17
-
-EAX		= 0x00
-EBX		= 0x04
-ECX		= 0x08
-EDX		= 0x0C
-FS		= 0x10
-ES		= 0x14
-DS		= 0x18
-EIP		= 0x1C
-CS		= 0x20
-EFLAGS		= 0x24
-OLDESP		= 0x28
-OLDSS		= 0x2C
-
-state	= 0		# these are offsets into the task-struct.
-counter	= 4
+# 0 "sys_call.S"
+# 0 "<built-in>"
+# 0 "<command-line>"
+# 1 "sys_call.S"
+
+
+
+
+
+
+# 1 "../include/linux/config.h" 1
+# 8 "sys_call.S" 2
+# 39 "sys_call.S"
+SIG_CHLD = 17
+
+EAX = 0x00
+EBX = 0x04
+ECX = 0x08
+EDX = 0x0C
+FS = 0x10
+ES = 0x14
+DS = 0x18
+EIP = 0x1C
+CS = 0x20
+EFLAGS = 0x24
+OLDESP = 0x28
+OLDSS = 0x2C
+
+state = 0 # these are offsets into the task-struct.
+counter = 4
 priority = 8
-signal	= 12
-sigaction = 16		# MUST be 16 (=len of sigaction)
+signal = 12
+sigaction = 16 # MUST be 16 (=len of sigaction)
 blocked = (33*16)
 
 # offsets within sigaction
@@ -58,228 +39,309 @@ sa_mask = 4
 sa_flags = 8
 sa_restorer = 12
 
-nr_system_calls = 74
+nr_system_calls = 86
+
 
-/*
- * Ok, I get parallel printer interrupts while using the floppy for some
- * strange reason. Urgel. Now I just ignore them.
- */
-.globl system_call,sys_fork,timer_interrupt,sys_execve
+
+
+
+.globl system_call,sys_fork,sys_clone,timer_interrupt,sys_execve,ret_from_fork
+.globl sysenter_entry
 .globl hd_interrupt,floppy_interrupt,parallel_interrupt
-.globl device_not_available, coprocessor_error
+.globl device_not_available, coprocessor_error, simd_coprocessor_error
 
 .align 2
 bad_sys_call:
-	movl $-1,%eax
-	iret
+ movl $-1,%eax
+ iret
 .align 2
 reschedule:
-	pushl $ret_from_sys_call
-	jmp schedule
+ pushl $ret_from_sys_call
+ jmp schedule
+# 94 "sys_call.S"
+.align 2
+sysenter_entry:
+ movl (%esp),%esp
+ pushl $0x17 # ss
+ pushl %ebp # esp, past the return address
+ addl $4,(%esp)
+ pushfl
+ orl $0x200,(%esp) # sysenter cleared IF
+ pushl $0x0f # cs
+ subl $4,%esp # eip
+ push %fs
+ pushl %ecx
+ movl $0x17,%ecx
+ mov %cx,%fs
+ movl %fs:(%ebp),%ecx
+ movl %ecx,8(%esp)
+ popl %ecx
+ pop %fs
+ sti
 .align 2
 system_call:
-	cmpl $nr_system_calls-1,%eax
-	ja bad_sys_call
-	push %ds
-	push %es
-	push %fs
-	pushl %edx
-	pushl %ecx		# push %ebx,%ecx,%edx as parameters
-	pushl %ebx		# to the system call
-	movl $0x10,%edx		# set up ds,es to kernel space
-	mov %dx,%ds
-	mov %dx,%es
-	movl $0x17,%edx		# fs points to local data space
-	mov %dx,%fs
-	call *sys_call_table(,%eax,4)
-	pushl %eax
-	movl current,%eax
-	cmpl $0,state(%eax)		# state
-	jne reschedule
-	cmpl $0,counter(%eax)		# counter
-	je reschedule
+ cmpl $nr_system_calls-1,%eax
+ ja bad_sys_call
+ push %ds
+ push %es
+ push %fs
+ pushl %edx
+ pushl %ecx # push %ebx,%ecx,%edx as parameters
+ pushl %ebx # to the system call
+ movl $0x10,%edx # set up ds,es to kernel space
+ mov %dx,%ds
+ mov %dx,%es
+ movl $0x17,%edx # fs points to local data space
+ mov %dx,%fs
+
+
+
+
+
+ call *sys_call_table(,%eax,4)
+ pushl %eax
+
+
+
+ movl current,%eax
+ cmpl $0,state(%eax) # state
+ jne reschedule
+ cmpl $0,counter(%eax) # counter
+ je reschedule
 ret_from_sys_call:
-	movl current,%eax		# task[0] cannot have signals
-	cmpl task,%eax
-	je 3f
-	cmpw $0x0f,CS(%esp)		# was old code segment supervisor ?
-	jne 3f
-	cmpw $0x17,OLDSS(%esp)		# was stack segment = 0x17 ?
-	jne 3f
-	movl signal(%eax),%ebx
-	movl blocked(%eax),%ecx
-	notl %ecx
-	andl %ebx,%ecx
-	bsfl %ecx,%ecx
-	je 3f
-	btrl %ecx,%ebx
-	movl %ebx,signal(%eax)
-	incl %ecx
-	pushl %ecx
-	call do_signal
-	popl %eax
-3:	popl %eax
-	popl %ebx
-	popl %ecx
-	popl %edx
-	pop %fs
-	pop %es
-	pop %ds
-	iret
+ movl current,%eax # task[0] cannot have signals
+ cmpl task,%eax
+ je 3f
+ cmpw $0x0f,CS(%esp) # was old code segment supervisor ?
+ jne 3f
+ cmpw $0x17,OLDSS(%esp) # was stack segment = 0x17 ?
+ jne 3f
+ movl signal(%eax),%ebx
+ movl blocked(%eax),%ecx
+ notl %ecx
+ andl %ebx,%ecx
+ bsfl %ecx,%ecx
+ je 3f
+ btrl %ecx,%ebx
+ movl %ebx,signal(%eax)
+ incl %ecx
+ pushl %ecx
+ call do_signal
+ popl %eax
+3: popl %eax
+ popl %ebx
+ popl %ecx
+ popl %edx
+ pop %fs
+ pop %es
+ pop %ds
+ iret
 
 .align 2
 coprocessor_error:
-	push %ds
-	push %es
-	push %fs
-	pushl %edx
-	pushl %ecx
-	pushl %ebx
-	pushl %eax
-	movl $0x10,%eax
-	mov %ax,%ds
-	mov %ax,%es
-	movl $0x17,%eax
-	mov %ax,%fs
-	pushl $ret_from_sys_call
-	jmp math_error
+ push %ds
+ push %es
+ push %fs
+ pushl %edx
+ pushl %ecx
+ pushl %ebx
+ pushl %eax
+ movl $0x10,%eax
+ mov %ax,%ds
+ mov %ax,%es
+ movl $0x17,%eax
+ mov %ax,%fs
+ pushl $ret_from_sys_call
+ jmp math_error
+
+.align 2
+simd_coprocessor_error:
+ push %ds
+ push %es
+ push %fs
+ pushl %edx
+ pushl %ecx
+ pushl %ebx
+ pushl %eax
+ movl $0x10,%eax
+ mov %ax,%ds
+ mov %ax,%es
+ movl $0x17,%eax
+ mov %ax,%fs
+ pushl $ret_from_sys_call
+ jmp do_simd_coprocessor_error
 
 .align 2
 device_not_available:
-	push %ds
-	push %es
-	push %fs
-	pushl %edx
-	pushl %ecx
-	pushl %ebx
-	pushl %eax
-	movl $0x10,%eax
-	mov %ax,%ds
-	mov %ax,%es
-	movl $0x17,%eax
-	mov %ax,%fs
-	pushl $ret_from_sys_call
-	clts				# clear TS so that we can use math
-	movl %cr0,%eax
-	testl $0x4,%eax			# EM (math emulation bit)
-	je math_state_restore
-	pushl %ebp
-	pushl %esi
-	pushl %edi
-	call math_emulate
-	popl %edi
-	popl %esi
-	popl %ebp
-	ret
+ push %ds
+ push %es
+ push %fs
+ pushl %edx
+ pushl %ecx
+ pushl %ebx
+ pushl %eax
+ movl $0x10,%eax
+ mov %ax,%ds
+ mov %ax,%es
+ movl $0x17,%eax
+ mov %ax,%fs
+ pushl $ret_from_sys_call
+ clts # clear TS so that we can use math
+ movl %cr0,%eax
+ testl $0x4,%eax # EM (math emulation bit)
+ je math_state_restore
+ pushl %ebp
+ pushl %esi
+ pushl %edi
+ call math_emulate
+ popl %edi
+ popl %esi
+ popl %ebp
+ ret
 
 .align 2
 timer_interrupt:
-	push %ds		                    # 保存 ds es fs 
-	push %es
-	push %fs
-	pushl %edx		                    # 保存 edx ecx ebx eax
-	pushl %ecx
-	pushl %ebx
-	pushl %eax
-	movl $0x10, %eax                    # 设置 ds es 为 0x10，0b00010 0 00，gdt 数据段 权限0级别
-	mov %ax, %ds
-	mov %ax, %es
-	movl $0x17, %eax                    # 设置 fs 为 0x17，0b00010 1 11，idt 数据段 权限3级别
-	mov %ax, %fs
-	incl jiffies                        # 增加 jiffies 计数器
-	movb $0x20, %al                     # 向 8259A 主芯片发送 EOI 命令
-	outb %al, $0x20
-	movl CS(%esp), %eax                 # 获取当前代码段选择子中的权限位
-	andl $3, %eax
-	pushl %eax                          # 将权限位压入栈中
-	call do_timer                       # do_timer(long CPL)
-	addl $4, %esp                       # 跳过 CPL 权限位
-	jmp ret_from_sys_call               # 执行 ret_from_sys_call
+ push %ds # 保存 ds es fs
+ push %es
+ push %fs
+ pushl %edx # 保存 edx ecx ebx eax
+ pushl %ecx
+ pushl %ebx
+ pushl %eax
+ movl $0x10, %eax # 设置 ds es 为 0x10，0b00010 0 00，gdt 数据段 权限0级别
+ mov %ax, %ds
+ mov %ax, %es
+ movl $0x17, %eax # 设置 fs 为 0x17，0b00010 1 11，idt 数据段 权限3级别
+ mov %ax, %fs
+ incl jiffies # 增加 jiffies 计数器
+ movb $0x20, %al # 向 8259A 主芯片发送 EOI 命令
+ outb %al, $0x20
+ movl CS(%esp), %eax # 获取当前代码段选择子中的权限位
+ andl $3, %eax
+ movl EIP(%esp), %ebx # 被中断的 eip，供 profiler 使用
+ pushl %ebx
+ pushl %eax # 将权限位压入栈中
+ call do_timer # do_timer(long CPL, long eip)
+ addl $8, %esp # 跳过 CPL 权限位和 eip
+ jmp ret_from_sys_call # 执行 ret_from_sys_call
 
 .align 2
 sys_execve:
-	lea EIP(%esp),%eax
-	pushl %eax
-	call do_execve
-	addl $4,%esp
-	ret
+ lea EIP(%esp),%eax
+ pushl %eax
+ call do_execve
+ addl $4,%esp
+ ret
 
 .align 2
 sys_fork:
-	call find_empty_process
-	testl %eax, %eax
-	js 1f
-	push %gs                            # 压栈 gs esi edi ebp eax
-	pushl %esi
-	pushl %edi
-	pushl %ebp
-	pushl %eax
-	call copy_process                   # 
-	addl $20,%esp
-1:	ret
+ call find_empty_process
+ testl %eax, %eax
+ js 1f
+ push %gs # 压栈 gs esi edi ebp eax
+ pushl %esi
+ pushl %edi
+ pushl %ebp
+ pushl %eax
+ pushl $0 # no new stack
+ pushl $0 # no clone flags
+ call copy_process #
+ addl $28,%esp
+1: ret
+
+
+
+
+
+.align 2
+sys_clone:
+ call find_empty_process
+ testl %eax,%eax
+ js 1f
+ push %gs
+ pushl %esi
+ pushl %edi
+ pushl %ebp
+ pushl %eax
+ pushl 28(%esp) # stack, the saved %ecx
+ pushl 28(%esp) # flags, the saved %ebx
+ call copy_process
+ addl $28,%esp
+1: ret
+
+
+
+
+
+.align 2
+ret_from_fork:
+ popl %ebp
+ popl %edi
+ popl %esi
+ jmp ret_from_sys_call
 
 hd_interrupt:
-	pushl %eax
-	pushl %ecx
-	pushl %edx
-	push %ds
-	push %es
-	push %fs
-	movl $0x10,%eax
-	mov %ax,%ds
-	mov %ax,%es
-	movl $0x17,%eax
-	mov %ax,%fs
-	movb $0x20,%al
-	outb %al,$0xA0		# EOI to interrupt controller #1
-	jmp 1f			# give port chance to breathe
-1:	jmp 1f
-1:	xorl %edx,%edx
-	xchgl do_hd,%edx
-	testl %edx,%edx
-	jne 1f
-	movl $unexpected_hd_interrupt,%edx
-1:	outb %al,$0x20
-	call *%edx		# "interesting" way of handling intr.
-	pop %fs
-	pop %es
-	pop %ds
-	popl %edx
-	popl %ecx
-	popl %eax
-	iret
+ pushl %eax
+ pushl %ecx
+ pushl %edx
+ push %ds
+ push %es
+ push %fs
+ movl $0x10,%eax
+ mov %ax,%ds
+ mov %ax,%es
+ movl $0x17,%eax
+ mov %ax,%fs
+ movb $0x20,%al
+ outb %al,$0xA0 # EOI to interrupt controller #1
+ jmp 1f # give port chance to breathe
+1: jmp 1f
+1: xorl %edx,%edx
+ xchgl do_hd,%edx
+ testl %edx,%edx
+ jne 1f
+ movl $unexpected_hd_interrupt,%edx
+1: outb %al,$0x20
+ call *%edx # "interesting" way of handling intr.
+ pop %fs
+ pop %es
+ pop %ds
+ popl %edx
+ popl %ecx
+ popl %eax
+ iret
 
 floppy_interrupt:
-	pushl %eax
-	pushl %ecx
-	pushl %edx
-	push %ds
-	push %es
-	push %fs
-	movl $0x10,%eax
-	mov %ax,%ds
-	mov %ax,%es
-	movl $0x17,%eax
-	mov %ax,%fs
-	movb $0x20,%al
-	outb %al,$0x20		# EOI to interrupt controller #1
-	xorl %eax,%eax
-	xchgl do_floppy,%eax
-	testl %eax,%eax
-	jne 1f
-	movl $unexpected_floppy_interrupt,%eax
-1:	call *%eax		# "interesting" way of handling intr.
-	pop %fs
-	pop %es
-	pop %ds
-	popl %edx
-	popl %ecx
-	popl %eax
-	iret
+ pushl %eax
+ pushl %ecx
+ pushl %edx
+ push %ds
+ push %es
+ push %fs
+ movl $0x10,%eax
+ mov %ax,%ds
+ mov %ax,%es
+ movl $0x17,%eax
+ mov %ax,%fs
+ movb $0x20,%al
+ outb %al,$0x20 # EOI to interrupt controller #1
+ xorl %eax,%eax
+ xchgl do_floppy,%eax
+ testl %eax,%eax
+ jne 1f
+ movl $unexpected_floppy_interrupt,%eax
+1: call *%eax # "interesting" way of handling intr.
+ pop %fs
+ pop %es
+ pop %ds
+ popl %edx
+ popl %ecx
+ popl %eax
+ iret
 
 parallel_interrupt:
-	pushl %eax
-	movb $0x20,%al
-	outb %al,$0x20
-	popl %eax
-	iret
+ pushl %eax
+ movb $0x20,%al
+ outb %al,$0x20
+ popl %eax
+ iret
@@ -56,6 +56,7 @@ void stack_segment(void);
 void general_protection(void);
 void page_fault(void);
 void coprocessor_error(void);
+void simd_coprocessor_error(void);
 void reserved(void);
 void parallel_interrupt(void);
 void irq13(void);
@@ -97,11 +98,12 @@ static void die(char *str, long esp_ptr, long nr)
         printk("\n");
     }
 
-    // 此处 str(i) 疑似代码有误，可能是笔误，原代码逻辑无法正常执行
-    str(i);
+    // 任务切换不再经过 TSS，进程编号从 task[] 中查找
+    for (i = 0; i < NR_TASKS && task[i] != current; i++)
+        /* nothing */;
 
     // 打印当前进程的 PID 和进程编号
-    printk("Pid: %d, process nr: %d\n\r", current->pid, 0xffff & i);
+    printk("Pid: %d, process nr: %d\n\r", current->pid, i);
 
     // 打印代码段的前 10 个字节
     for (i = 0; i < 10; i++) {
@@ -179,9 +181,19 @@ void do_nmi(long esp, long error_code)
     die("nmi",esp,error_code);
 }
 
-void do_debug(long esp, long error_code)
+/*
+ * The only single-step trap in the kernel is from a TF that sysenter
+ * brought along: clear it and go on. In user mode it prints the
+ * registers, as int3 does.
+ */
+void do_debug(long *esp, long error_code, long fs, long es, long ds,
+              long ebp, long esi, long edi, long edx, long ecx, long ebx, long eax)
 {
-    die("debug",esp,error_code);
+    if (!(esp[1] & 3)) {
+        esp[2] &= ~0x100;
+        return;
+    }
+    do_int3(esp, error_code, fs, es, ds, ebp, esi, edi, edx, ecx, ebx, eax);
 }
 
 void do_overflow(long esp, long error_code)
@@ -231,6 +243,16 @@ void do_coprocessor_error(long esp, long error_code)
     die("coprocessor error",esp,error_code);
 }
 
+/*
+ * An unmasked SSE exception: like math_error(), the task gets SIGFPE,
+ * on the way out through ret_from_sys_call. Its handler has to clear
+ * the flags in mxcsr.
+ */
+void do_simd_coprocessor_error(void)
+{
+    current->signal |= 1 << (SIGFPE - 1);
+}
+
 void do_reserved(long esp, long error_code)
 {
     die("reserved (15,17-47) error",esp,error_code);
@@ -274,6 +296,9 @@ void trap_init(void)
         set_trap_gate(i, &reserved);
     }
 
+    // 19 号为 SSE 浮点异常
+    set_trap_gate(19, &simd_coprocessor_error);
+
     // 为 45 号中断设置陷阱门
     set_trap_gate(45, &irq13);
 
@@ -37,8 +37,11 @@ int __res; \
 __asm__("divl %4":"=a" (n),"=d" (__res):"0" (n),"1" (0),"r" (base)); \
 __res; })
 
-static char * number(char * str, int num, int base, int size, int precision
-	,int type)
+/* output stops at 'end', but the length is still counted */
+#define PUTC(c) do { if (str < end) *str = (c); str++; } while (0)
+
+static char * number(char * str, char * end, int num, int base, int size,
+	int precision, int type)
 {
 	char c,sign,tmp[36];
 	const char *digits="0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
@@ -68,30 +71,34 @@ static char * number(char * str, int num, int base, int size, int precision
 	size -= precision;
 	if (!(type&(ZEROPAD+LEFT)))
 		while(size-->0)
-			*str++ = ' ';
+			PUTC(' ');
 	if (sign)
-		*str++ = sign;
+		PUTC(sign);
 	if (type&SPECIAL) {
 		if (base==8)
-			*str++ = '0';
+			PUTC('0');
 		else if (base==16) {
-			*str++ = '0';
-			*str++ = digits[33];
+			PUTC('0');
+			PUTC(digits[33]);
 		}
 	}
 	if (!(type&LEFT))
 		while(size-->0)
-			*str++ = c;
+			PUTC(c);
 	while(i<precision--)
-		*str++ = '0';
+		PUTC('0');
 	while(i-->0)
-		*str++ = tmp[i];
+		PUTC(tmp[i]);
 	while(size-->0)
-		*str++ = ' ';
+		PUTC(' ');
 	return str;
 }
 
-int vsprintf(char *buf, const char *fmt, va_list args)
+/*
+ * vsnprintf() writes at most size-1 characters and a '\0' to buf, and
+ * returns the length the whole output would have had.
+ */
+int vsnprintf(char *buf, int size, const char *fmt, va_list args)
 {
 	int len;
 	int i;
@@ -105,10 +112,17 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 	int precision;		/* min. # of digits for integers; max
 				   number of chars for from string */
 	int qualifier;		/* 'h', 'l', or 'L' for integer fields */
-
+	char * end;		/* last char of buf, kept for the '\0' */
+
+	if (size <= 0)
+		end = buf;
+	else if ((unsigned long) buf + size - 1 < (unsigned long) buf)
+		end = (char *) ~0UL;		/* vsprintf(): no bound */
+	else
+		end = buf + size - 1;
 	for (str=buf ; *fmt ; ++fmt) {
 		if (*fmt != '%') {
-			*str++ = *fmt;
+			PUTC(*fmt);
 			continue;
 		}
 			
@@ -162,10 +176,10 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 		case 'c':
 			if (!(flags & LEFT))
 				while (--field_width > 0)
-					*str++ = ' ';
-			*str++ = (unsigned char) va_arg(args, int);
+					PUTC(' ');
+			PUTC((unsigned char) va_arg(args, int));
 			while (--field_width > 0)
-				*str++ = ' ';
+				PUTC(' ');
 			break;
 
 		case 's':
@@ -178,15 +192,15 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 
 			if (!(flags & LEFT))
 				while (len < field_width--)
-					*str++ = ' ';
+					PUTC(' ');
 			for (i = 0; i < len; ++i)
-				*str++ = *s++;
+				PUTC(*s++);
 			while (len < field_width--)
-				*str++ = ' ';
+				PUTC(' ');
 			break;
 
 		case 'o':
-			str = number(str, va_arg(args, unsigned long), 8,
+			str = number(str, end, va_arg(args, unsigned long), 8,
 				field_width, precision, flags);
 			break;
 
@@ -195,7 +209,7 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 				field_width = 8;
 				flags |= ZEROPAD;
 			}
-			str = number(str,
+			str = number(str, end,
 				(unsigned long) va_arg(args, void *), 16,
 				field_width, precision, flags);
 			break;
@@ -203,7 +217,7 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 		case 'x':
 			flags |= SMALL;
 		case 'X':
-			str = number(str, va_arg(args, unsigned long), 16,
+			str = number(str, end, va_arg(args, unsigned long), 16,
 				field_width, precision, flags);
 			break;
 
@@ -211,7 +225,7 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 		case 'i':
 			flags |= SIGN;
 		case 'u':
-			str = number(str, va_arg(args, unsigned long), 10,
+			str = number(str, end, va_arg(args, unsigned long), 10,
 				field_width, precision, flags);
 			break;
 
@@ -222,14 +236,20 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 
 		default:
 			if (*fmt != '%')
-				*str++ = '%';
+				PUTC('%');
 			if (*fmt)
-				*str++ = *fmt;
+				PUTC(*fmt);
 			else
 				--fmt;
 			break;
 		}
 	}
-	*str = '\0';
+	if (size > 0)
+		*(str < end ? str : end) = '\0';
 	return str-buf;
 }
+
+int vsprintf(char *buf, const char *fmt, va_list args)
+{
+	return vsnprintf(buf, 0x7fffffff, fmt, args);
+}
@@ -1,5 +1,6 @@
 #include <string.h>
 #include <errno.h>
+#include <linux/kernel.h>
 #include <asm/segment.h>
 
 char msg[24]; //最多23个字符，外带一个回车符号
@@ -38,6 +39,8 @@ sys_whoami(char* name,unsigned int size)
 	if (len > size) {
 		return -EINVAL;	
 	}
+	if (verify_area(name,size))
+		return -EFAULT;
 	for (i = 0; i < size; ++i) {
 		put_fs_byte(msg[i],name+i);	
 		if (msg[i] == '\0') {
@@ -0,0 +1,11 @@
+/*
+ *  linux/lib/blkstat.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <linux/blkstat.h>
+
+_syscall2(int,blkstat,int,slot,struct blk_stat *,buf)
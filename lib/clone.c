@@ -0,0 +1,40 @@
+/*
+ *  linux/lib/clone.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+
+/*
+ * Start fn(arg) in a new task on 'stack', the top of a stack the caller
+ * has set aside. fn and arg are put on it first, so the child finds them
+ * there: it never returns from here, but calls exit() with what fn gives
+ * back. This goes through int $0x80 even where sysenter is used: the
+ * sysenter stub would restore %ebp from the new stack.
+ */
+int clone(int (*fn)(void *), void * stack, int flags, void * arg)
+{
+	long * sp = (long *) stack;
+	long __res;
+
+	*--sp = (long) arg;
+	*--sp = (long) fn;
+	__asm__ volatile ("int $0x80\n\t"
+		"testl %0,%0\n\t"
+		"jne 1f\n\t"
+		"popl %%eax\n\t"
+		"call *%%eax\n\t"
+		"movl %%eax,%%ebx\n\t"
+		"movl %2,%%eax\n\t"
+		"int $0x80\n"
+		"1:"
+		: "=a" (__res)
+		: "0" (__NR_clone),"i" (__NR_exit),"b" (flags),"c" ((long) sp)
+		: "memory");
+	if (__res >= 0)
+		return __res;
+	errno = -__res;
+	return -1;
+}
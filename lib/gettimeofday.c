@@ -0,0 +1,52 @@
+/*
+ *  linux/lib/gettimeofday.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <linux/timepage.h>
+
+/*
+ * Both calls read the time page that execve() maps into every process,
+ * and only trap into the kernel if the TSC can't be used.
+ */
+int gettimeofday(struct timeval * tv, struct timezone * tz)
+{
+	long __res;
+
+	if (tv && !tz &&
+	    !time_page_read((struct time_page *) TIME_PAGE_ADDR, tv, 1))
+		return 0;
+	__asm__ volatile ("int $0x80"
+		: "=a" (__res)
+		: "0" (__NR_gettimeofday),"b" ((long)(tv)),"c" ((long)(tz)));
+	if (__res >= 0)
+		return (int) __res;
+	errno = -__res;
+	return -1;
+}
+
+int clock_gettime(clockid_t clk, struct timespec * tp)
+{
+	struct timeval tv;
+	long __res;
+
+	if ((clk == CLOCK_REALTIME || clk == CLOCK_MONOTONIC) &&
+	    !time_page_read((struct time_page *) TIME_PAGE_ADDR, &tv,
+	    clk == CLOCK_REALTIME)) {
+		tp->tv_sec = tv.tv_sec;
+		tp->tv_nsec = tv.tv_usec * 1000;
+		return 0;
+	}
+	__asm__ volatile ("int $0x80"
+		: "=a" (__res)
+		: "0" (__NR_clock_gettime),"b" ((long)(clk)),"c" ((long)(tp)));
+	if (__res >= 0)
+		return (int) __res;
+	errno = -__res;
+	return -1;
+}
@@ -0,0 +1,33 @@
+/*
+ *  linux/lib/mmap.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* the kernel takes a pointer to the six arguments, see mm/mmap.c */
+void * mmap(void * addr, size_t len, int prot, int flags, int fd, off_t offset)
+{
+	unsigned long arg[6];
+	long __res;
+
+	arg[0] = (unsigned long) addr;
+	arg[1] = len;
+	arg[2] = prot;
+	arg[3] = flags;
+	arg[4] = fd;
+	arg[5] = offset;
+	__asm__ volatile ("int $0x80"
+		: "=a" (__res)
+		: "0" (__NR_mmap),"b" ((long) arg)
+		: "memory");
+	if (__res >= 0)
+		return (void *) __res;
+	errno = -__res;
+	return MAP_FAILED;
+}
+
+_syscall2(int,munmap,void *,addr,size_t,len)
@@ -0,0 +1,304 @@
+/*
+ *  linux/mm/filemap.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * The page cache keeps whole pages of file data. Regular-file reads are
+ * copied out of it, and executable faults map its pages straight into
+ * the task. The buffer cache still owns the blocks and writes them back:
+ * file_write() goes through it and then patches any cached page that
+ * holds the block, so the two always agree.
+ *
+ * Pages are found by (inode, first logical block). read() uses pages
+ * starting on a multiple of four blocks, but the text of an executable
+ * starts one block into the file, so its pages start at 1+4n. A block
+ * can thus be in two cached pages at once.
+ *
+ * The cache holds one mem_map reference to each of its pages, and every
+ * mapping or caller of read_cache_page() holds another. Pages used by
+ * nobody else are dropped when memory runs low, in clock order. Entries
+ * live as long as the in-core inode: get_empty_inode() and truncate()
+ * throw them away.
+ */
+
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/pagemap.h>
+
+#define NR_PAGE_HASH 307
+#define ENTRIES_PER_PAGE (PAGE_SIZE/sizeof(struct cache_page))
+#define NR_ENTRY_PAGES ((PAGING_PAGES+ENTRIES_PER_PAGE-1)/ENTRIES_PER_PAGE)
+
+#define _hashfn(inode,block) \
+	((((unsigned long) (inode))^(block)) % NR_PAGE_HASH)
+#define hash(inode,block) page_hash[_hashfn(inode,block)]
+
+static struct cache_page * page_hash[NR_PAGE_HASH];
+static struct cache_page * entry_page[NR_ENTRY_PAGES];
+static struct cache_page * free_entries = NULL;
+static int nr_entries = 0;
+static int clock_hand = 0;
+
+static inline struct cache_page * cache_entry(int i)
+{
+	return entry_page[i / ENTRIES_PER_PAGE] + i % ENTRIES_PER_PAGE;
+}
+
+static struct cache_page * find_page(struct m_inode * inode, int block)
+{
+	struct cache_page * p;
+
+	for (p = hash(inode,block) ; p ; p = p->next)
+		if (p->inode == inode && p->block == block)
+			return p;
+	return NULL;
+}
+
+/*
+ * Entries come in pages of their own that are never given back. Note
+ * that get_free_page() may shrink the cache while we wait for it.
+ */
+static struct cache_page * get_entry(void)
+{
+	struct cache_page * p;
+	int i;
+
+	if (!free_entries) {
+		if (nr_entries >= NR_ENTRY_PAGES*ENTRIES_PER_PAGE)
+			return NULL;
+		if (!(p = (struct cache_page *) get_free_page()))
+			return NULL;
+		entry_page[nr_entries / ENTRIES_PER_PAGE] = p;
+		for (i=0 ; i<ENTRIES_PER_PAGE ; i++,p++) {
+			p->next = free_entries;
+			free_entries = p;
+		}
+		nr_entries += ENTRIES_PER_PAGE;
+	}
+	p = free_entries;
+	free_entries = p->next;
+	return p;
+}
+
+static void remove_page(struct cache_page * p)
+{
+	struct cache_page ** pp;
+
+	for (pp = &hash(p->inode,p->block) ; *pp ; pp = &(*pp)->next)
+		if (*pp == p) {
+			*pp = p->next;
+			break;
+		}
+	p->inode->i_pages--;
+	free_page(p->page);
+	p->page = 0;
+	p->inode = NULL;
+	p->next = free_entries;
+	free_entries = p;
+}
+
+/*
+ * read_cache_page() returns the page holding blocks 'block' to 'block+3'
+ * of the inode, reading it in if need be. The caller gets a reference
+ * of its own and has to free_page() it. Returns 0 if out of memory.
+ *
+ * With no cache entry to spare the page is returned uncached, which is
+ * fine for reading. read_shared_page() is for MAP_SHARED mappings, which
+ * have to see the same page as everybody else: it makes room in the
+ * cache, and returns 0 if it can't.
+ */
+static unsigned long __read_cache_page(struct m_inode * inode, int block,
+	int shared)
+{
+	struct cache_page * p;
+	unsigned long page;
+	int nr[4], i;
+
+	if ((p = find_page(inode,block))) {
+		p->referenced = 1;
+		mem_map[MAP_NR(p->page)]++;
+		return p->page;
+	}
+	if (!(page = get_free_page()))
+		return 0;
+	for (i=0 ; i<4 ; i++)
+		nr[i] = bmap(inode,block+i);
+	bread_page(page,inode->i_dev,nr);
+	p = get_entry();
+	if (!p && shared && shrink_page_cache(1))
+		p = get_entry();
+/* somebody else may have read it in while we slept */
+	if (find_page(inode,block)) {
+		if (p) {
+			p->next = free_entries;
+			free_entries = p;
+		}
+		free_page(page);
+		return __read_cache_page(inode,block,shared);
+	}
+	if (!p) {
+		if (!shared)
+			return page;		/* uncached, but still good */
+		free_page(page);
+		return 0;
+	}
+	p->inode = inode;
+	p->block = block;
+	p->page = page;
+	p->referenced = 1;
+	p->next = hash(inode,block);
+	hash(inode,block) = p;
+	inode->i_pages++;
+	mem_map[MAP_NR(page)]++;
+	return page;
+}
+
+unsigned long read_cache_page(struct m_inode * inode, int block)
+{
+	return __read_cache_page(inode,block,0);
+}
+
+unsigned long read_shared_page(struct m_inode * inode, int block)
+{
+	return __read_cache_page(inode,block,1);
+}
+
+/*
+ * try_cache_page() is read_cache_page() for fault-around: it returns 0
+ * rather than start any I/O for the data, so it only finds pages that
+ * are cached, or whose blocks all are.
+ */
+unsigned long try_cache_page(struct m_inode * inode, int block)
+{
+	struct cache_page * p;
+	struct buffer_head * bh;
+	int i, nr, uptodate;
+
+	if ((p = find_page(inode,block))) {
+		p->referenced = 1;
+		mem_map[MAP_NR(p->page)]++;
+		return p->page;
+	}
+	for (i=0 ; i<4 ; i++) {
+		if (!(nr = bmap(inode,block+i)))
+			continue;
+		if (!(bh = get_hash_table(inode->i_dev,nr)))
+			return 0;
+		uptodate = bh->b_uptodate;
+		brelse(bh);
+		if (!uptodate)
+			return 0;
+	}
+	return read_cache_page(inode,block);
+}
+
+/*
+ * Start reading the blocks of a page that isn't cached, without waiting
+ * for them, like breada() does.
+ */
+void readahead_cache_page(struct m_inode * inode, int block)
+{
+	struct buffer_head * bh;
+	int i, nr;
+
+	if (find_page(inode,block))
+		return;
+	for (i=0 ; i<4 ; i++) {
+		if (!(nr = bmap(inode,block+i)))
+			continue;
+		if (!(bh = getblk(inode->i_dev,nr)))
+			return;
+		if (!bh->b_uptodate)
+			ll_rw_block(READA,bh);
+		bh->b_count--;
+	}
+}
+
+/*
+ * file_write() calls this after it has copied 'count' bytes of new data
+ * to 'offset' in logical block 'block'.
+ */
+void update_page_cache(struct m_inode * inode, int block,
+	int offset, char * data, int count)
+{
+	struct cache_page * p;
+	int i;
+
+	if (!inode->i_pages)
+		return;
+	for (i=0 ; i<4 && i<=block ; i++)
+		if ((p = find_page(inode,block-i)))
+			memcpy(i*BLOCK_SIZE + offset + (char *) p->page,
+				data,count);
+}
+
+/*
+ * write_cache_page() writes a page of a shared mapping back through the
+ * buffer cache, and into any other cached page holding the same blocks.
+ * Blocks past the end of the file are left alone: a mapping never makes
+ * the file grow.
+ */
+void write_cache_page(struct m_inode * inode, int block, unsigned long page)
+{
+	struct buffer_head * bh;
+	int i, nr;
+
+	for (i=0 ; i<4 ; i++,block++,page += BLOCK_SIZE) {
+		if (block*BLOCK_SIZE >= inode->i_size)
+			break;
+		if (!(nr = create_block(inode,block)))
+			break;
+		if (!(bh = getblk(inode->i_dev,nr)))
+			break;
+		memcpy(bh->b_data,(char *) page,BLOCK_SIZE);
+		bh->b_uptodate = 1;
+		bh->b_dirt = 1;
+		brelse(bh);
+		update_page_cache(inode,block,0,(char *) page,BLOCK_SIZE);
+	}
+}
+
+/*
+ * Tasks that have the pages mapped keep their references; the pages
+ * just stop being part of the cache.
+ */
+void invalidate_inode_pages(struct m_inode * inode)
+{
+	struct cache_page * p;
+	int i;
+
+	for (i=0 ; i<nr_entries && inode->i_pages ; i++) {
+		p = cache_entry(i);
+		if (p->page && p->inode == inode)
+			remove_page(p);
+	}
+}
+
+/*
+ * shrink_page_cache() frees up to 'pages' pages nobody but the cache
+ * uses, giving recently used ones a second chance. It never sleeps.
+ */
+int shrink_page_cache(int pages)
+{
+	struct cache_page * p;
+	int i, freed = 0;
+
+	for (i=0 ; i<2*nr_entries && freed<pages ; i++) {
+		if (clock_hand >= nr_entries)
+			clock_hand = 0;
+		p = cache_entry(clock_hand++);
+		if (!p->page || mem_map[MAP_NR(p->page)] != 1)
+			continue;
+		if (p->referenced) {
+			p->referenced = 0;
+			continue;
+		}
+		remove_page(p);
+		freed++;
+	}
+	return freed;
+}
@@ -20,13 +20,19 @@
  * Also corrected some "invalidate()"s - I wasn't doing enough of them.
  */
 
+#include <errno.h>
 #include <signal.h>
 
 #include <asm/system.h>
+#include <asm/cpufeature.h>
 
 #include <linux/sched.h>
 #include <linux/head.h>
 #include <linux/kernel.h>
+#include <linux/pagemap.h>
+#include <linux/slab.h>
+#include <linux/timepage.h>
+#include <sys/mman.h>
 
 void do_exit(long code);
 
@@ -36,16 +42,19 @@ static inline void oom(void)
 	do_exit(SIGSEGV);
 }
 
-#define invalidate() \
-__asm__("movl %%eax,%%cr3"::"a" (0))
-
-/* these are not to be changed without changing head.s etc */
-#define LOW_MEM 0x100000
-#define PAGING_MEMORY (15*1024*1024)
-#define PAGING_PAGES (PAGING_MEMORY>>12)
-#define MAP_NR(addr) (((addr)-LOW_MEM)>>12)
 #define USED 100
 
+/*
+ * The 386 has no invlpg, and flushes the whole TLB instead.
+ */
+void invalidate_page(unsigned long address)
+{
+	if (x86 > 3)
+		__asm__ __volatile__("invlpg (%0)"::"r" (address):"memory");
+	else
+		invalidate();
+}
+
 #define CODE_SPACE(addr) ((((addr)+4095)&~4095) < \
 current->start_code + current->end_code)
 
@@ -54,13 +63,32 @@ static long HIGH_MEMORY = 0;
 #define copy_page(from,to) \
 __asm__("cld ; rep ; movsl"::"S" (from),"D" (to),"c" (1024))
 
-static unsigned char mem_map [ PAGING_PAGES ] = {0,};
+unsigned char mem_map [ PAGING_PAGES ] = {0,};
+
+/*
+ * Reads of memory nobody has written yet, like bss, heap, stack and
+ * private anonymous mappings, all map this one page read-only. The
+ * first write gets a private page through do_wp_page(). It is below
+ * LOW_MEM, so mem_map doesn't count it and nobody ever frees it.
+ */
+unsigned long empty_zero_page[1024] __attribute__((aligned(PAGE_SIZE)));
+#define ZERO_PAGE ((unsigned long) empty_zero_page)
+
+/*
+ * The buffer cache grows into main memory while nr_free_pages is above
+ * a quarter of nr_main_pages, and get_free_page() makes it give clean
+ * pages back when less than a sixteenth is left.
+ */
+unsigned long nr_free_pages = 0;
+unsigned long nr_main_pages = 0;
+
+#define LOW_FREE_PAGES (nr_main_pages >> 4)
 
 /*
  * Get physical address of first (actually last :-) free page, and mark it
  * used. If no free pages left, return 0.
  */
-unsigned long get_free_page(void)
+static unsigned long find_free_page(void)
 {
 register unsigned long __res asm("ax");
 
@@ -82,6 +110,61 @@ __asm__("std ; repne ; scasb\n\t"
 return __res;
 }
 
+/*
+ * Empty pages kept by the object caches cost nothing to give back.
+ * Cached file pages are cheaper to drop than buffers, as the blocks
+ * are usually still in the buffer cache to refill them from.
+ */
+static int try_to_free_pages(int pages)
+{
+	int freed;
+
+	freed = kmem_cache_reap(pages);
+	if (freed < pages)
+		freed += shrink_page_cache(pages-freed);
+	if (freed < pages)
+		freed += shrink_buffers(pages-freed);
+	return freed;
+}
+
+/*
+ * get_free_page() never sleeps: under memory pressure it just takes
+ * back pages the caches can drop without doing any I/O.
+ */
+unsigned long get_free_page(void)
+{
+	unsigned long page;
+
+	if (nr_free_pages < LOW_FREE_PAGES)
+		try_to_free_pages(4);
+	if (!(page = find_free_page()) && try_to_free_pages(1))
+		page = find_free_page();
+	if (page)
+		nr_free_pages--;
+	return page;
+}
+
+/*
+ * get_user_page() is for the page-fault paths, which may sleep. A page
+ * is pushed out to swap for every one taken below SWAP_FREE_PAGES, so
+ * that swapping has some memory left to work with. When get_free_page()
+ * can't find a page even after shrinking the caches, task pages are
+ * pushed out until one comes free.
+ */
+#define SWAP_FREE_PAGES 16
+
+static unsigned long get_user_page(void)
+{
+	unsigned long page;
+
+	if (nr_free_pages < SWAP_FREE_PAGES)
+		swap_out();
+	while (!(page = get_free_page()))
+		if (!swap_out())
+			break;
+	return page;
+}
+
 /*
  * Free a page of memory at physical address 'addr'. Used by
  * 'free_page_tables()'
@@ -93,26 +176,47 @@ void free_page(unsigned long addr)
 		panic("trying to free nonexistent page");
 	addr -= LOW_MEM;
 	addr >>= 12;
-	if (mem_map[addr]--) return;
+	if (mem_map[addr]--) {
+		if (!mem_map[addr])
+			nr_free_pages++;
+		return;
+	}
 	mem_map[addr]=0;
 	panic("trying to free free page");
 }
 
+/*
+ * new_page_dir() makes a page directory for a new task. It shares the
+ * page tables of the kernel, which maps physical memory below
+ * TASK_BASE; everything above is the task's own.
+ */
+unsigned long * new_page_dir(void)
+{
+	unsigned long * dir;
+	int i;
+
+	if (!(dir = (unsigned long *) get_free_page()))
+		return NULL;
+	for (i=0 ; i < (TASK_BASE>>22) ; i++)
+		dir[i] = pg_dir[i];
+	return dir;
+}
+
 /*
  * This function frees a continuos block of page tables, as needed
  * by 'exit()'. As does copy_page_tables(), this handles only 4Mb blocks.
  */
-int free_page_tables(unsigned long from,unsigned long size)
+int free_page_tables(unsigned long * dir,unsigned long from,unsigned long size)
 {
 	unsigned long *pg_table;
-	unsigned long * dir, nr;
+	unsigned long nr;
 
 	if (from & 0x3fffff)
 		panic("free_page_tables called with wrong alignment");
 	if (!from)
 		panic("Trying to free up swapper memory space");
 	size = (size + 0x3fffff) >> 22;
-	dir = (unsigned long *) ((from>>20) & 0xffc); /* _pg_dir = 0 */
+	dir = pg_dir_entry(dir,from);
 	for ( ; size-->0 ; dir++) {
 		if (!(1 & *dir))
 			continue;
@@ -120,6 +224,8 @@ int free_page_tables(unsigned long from,unsigned long size)
 		for (nr=0 ; nr<1024 ; nr++) {
 			if (1 & *pg_table)
 				free_page(0xfffff000 & *pg_table);
+			else if (*pg_table)
+				swap_free(SWP_NR(*pg_table));
 			*pg_table = 0;
 			pg_table++;
 		}
@@ -147,19 +253,19 @@ int free_page_tables(unsigned long from,unsigned long size)
  * 1 Mb-range, so the pages can be shared with the kernel. Thus the
  * special case for nr=xxxx.
  */
-int copy_page_tables(unsigned long from, unsigned long to, long size)
+int copy_page_tables(unsigned long * from_dir, unsigned long from,
+	unsigned long * to_dir, unsigned long to, long size)
 {
 	unsigned long *from_page_table;
 	unsigned long *to_page_table;
 	unsigned long this_page;
-	unsigned long *from_dir, *to_dir;
 	unsigned long nr;
 
 	if ((from & 0x3fffff) || (to & 0x3fffff))
 		panic("copy_page_tables called with wrong alignment");
 
-	from_dir = (unsigned long *) ((from >> 20) & 0xffc); /* _pg_dir = 0 */
-	to_dir = (unsigned long *) ((to >> 20) & 0xffc);
+	from_dir = pg_dir_entry(from_dir,from);
+	to_dir = pg_dir_entry(to_dir,to);
 	size = ((unsigned) (size + 0x3fffff)) >> 22;
 
 	for( ; size-- > 0; from_dir++,to_dir++) {
@@ -175,8 +281,13 @@ int copy_page_tables(unsigned long from, unsigned long to, long size)
 		nr = (from == 0) ? 0xA0 : 1024;
 		for ( ; nr-- > 0 ; from_page_table++,to_page_table++) {
 			this_page = *from_page_table;
-			if (!(1 & this_page))
+			if (!(1 & this_page)) {
+				if (this_page) {
+					swap_duplicate(SWP_NR(this_page));
+					*to_page_table = this_page;
+				}
 				continue;
+			}
 			this_page &= ~2;
 			*to_page_table = this_page;
 			if (this_page > LOW_MEM) {
@@ -193,6 +304,51 @@ int copy_page_tables(unsigned long from, unsigned long to, long size)
     return 0;
 }
 
+/*
+ * get_pte() returns a pointer to the page table entry for 'address',
+ * allocating the page table if there is none. NULL means out of memory.
+ */
+static unsigned long * get_pte(unsigned long address)
+{
+	unsigned long tmp, *page_table;
+
+	page_table = pg_dir_entry(task_pg_dir(current),address);
+	if ((*page_table)&1)
+		page_table = (unsigned long *) (0xfffff000 & *page_table);
+	else {
+		if (!(tmp=get_free_page()))
+			return NULL;
+/* get_free_page() may sleep, and a thread may have made the table */
+		if ((*page_table)&1)
+			free_page(tmp);
+		else
+			*page_table = tmp|7;
+		page_table = (unsigned long *) (0xfffff000 & *page_table);
+	}
+	return page_table + ((address>>12) & 0x3ff);
+}
+
+/*
+ * The fault paths may sleep between finding an entry empty and filling
+ * it in, and a thread sharing the address space may fault on the same
+ * page meanwhile. If the entry is taken by then, our page is dropped,
+ * and the fault simply happens again if it has to.
+ */
+static unsigned long install_page(unsigned long page, unsigned long address,
+	unsigned long prot)
+{
+	unsigned long *pte;
+
+	if (!(pte = get_pte(address)))
+		return 0;
+	if (*pte) {
+		free_page(page);
+		return page;
+	}
+	*pte = page | prot;
+	return page;
+}
+
 /*
  * This function puts a page in memory at the wanted address.
  * It returns the physical address of the page gotten, 0 if
@@ -201,47 +357,87 @@ int copy_page_tables(unsigned long from, unsigned long to, long size)
  */
 unsigned long put_page(unsigned long page,unsigned long address)
 {
-	unsigned long tmp, *page_table;
-
-/* NOTE !!! This uses the fact that _pg_dir=0 */
-
 	if (page < LOW_MEM || page >= HIGH_MEMORY)
 		printk("Trying to put page %p at %p\n",page,address);
 	if (mem_map[(page-LOW_MEM)>>12] != 1)
 		printk("mem_map disagrees with %p at %p\n",page,address);
-	page_table = (unsigned long *) ((address>>20) & 0xffc);
-	if ((*page_table)&1)
-		page_table = (unsigned long *) (0xfffff000 & *page_table);
-	else {
-		if (!(tmp=get_free_page()))
-			return 0;
-		*page_table = tmp|7;
-		page_table = (unsigned long *) tmp;
-	}
-	page_table[(address>>12) & 0x3ff] = page | 7;
 /* no need for invalidate */
-	return page;
+	return install_page(page,address,7);
+}
+
+/*
+ * put_shared_page() maps a page that has other users, like the page
+ * cache, read-only at 'address'. The caller's reference becomes the
+ * mapping's; a write fault gives the task a copy of its own.
+ */
+static unsigned long put_shared_page(unsigned long page,unsigned long address)
+{
+	return install_page(page,address,5);
 }
 
-void un_wp_page(unsigned long * table_entry)
+/*
+ * put_kernel_page() maps a page of the kernel image read-only at a
+ * user address. Pages below LOW_MEM are never counted in mem_map, so
+ * fork() shares the mapping and exit() leaves the page alone.
+ */
+unsigned long put_kernel_page(unsigned long page,unsigned long address)
+{
+	if (page >= LOW_MEM)
+		printk("Trying to put kernel page %p at %p\n",page,address);
+	return install_page(page,address,5);
+}
+
+void un_wp_page(unsigned long * table_entry, unsigned long address)
 {
-	unsigned long old_page,new_page;
+	unsigned long old_page,new_page,entry;
 
-	old_page = 0xfffff000 & *table_entry;
+	entry = *table_entry;
+	old_page = 0xfffff000 & entry;
 	if (old_page >= LOW_MEM && mem_map[MAP_NR(old_page)]==1) {
 		*table_entry |= 2;
-		invalidate();
+		invalidate_page(address);
 		return;
 	}
-	if (!(new_page=get_free_page()))
+	if (!(new_page=get_user_page()))
 		oom();
+/* swapping may have slept: if the entry changed, just fault again */
+	if (*table_entry != entry) {
+		free_page(new_page);
+		return;
+	}
 	if (old_page >= LOW_MEM)
 		mem_map[MAP_NR(old_page)]--;
 	*table_entry = new_page | 7;
-	invalidate();
-	copy_page(old_page,new_page);
+	invalidate_page(address);
+/* new pages come zeroed */
+	if (old_page != ZERO_PAGE)
+		copy_page(old_page,new_page);
 }	
 
+/*
+ * Pages of mmap()ed areas are special: a read-only area can't be
+ * written at all, and a shared one is written in place, even when
+ * fork() has write-protected it. Nor can the time page: a private
+ * copy of it would just stop the clock.
+ */
+static void wp_page(unsigned long * table_entry, unsigned long address)
+{
+	struct vm_area_struct * area;
+
+	if ((*table_entry & 0xfffff000) == (unsigned long) &time_page)
+		do_exit(SIGSEGV);
+	if ((area = find_vma(current,address - current->start_code))) {
+		if (!(area->vm_prot & PROT_WRITE))
+			do_exit(SIGSEGV);
+		if (area->vm_flags & MAP_SHARED) {
+			*table_entry |= 2;
+			invalidate_page(address);
+			return;
+		}
+	}
+	un_wp_page(table_entry,address);
+}
+
 /*
  * This routine handles present pages, when users try to write
  * to a shared page. It is done by copying the page to a new address
@@ -257,9 +453,9 @@ void do_wp_page(unsigned long error_code,unsigned long address)
 	if (CODE_SPACE(address))
 		do_exit(SIGSEGV);
 #endif
-	un_wp_page((unsigned long *)
+	wp_page((unsigned long *)
 		(((address>>10) & 0xffc) + (0xfffff000 &
-		*((unsigned long *) ((address>>20) &0xffc)))));
+		*pg_dir_entry(task_pg_dir(current),address))),address);
 
 }
 
@@ -267,12 +463,12 @@ void write_verify(unsigned long address)
 {
 	unsigned long page;
 
-	if (!( (page = *((unsigned long *) ((address>>20) & 0xffc)) )&1))
+	if (!( (page = *pg_dir_entry(task_pg_dir(current),address)) &1))
 		return;
 	page &= 0xfffff000;
 	page += ((address>>10) & 0xffc);
 	if ((3 & *(unsigned long *) page) == 1)  /* non-writeable, present */
-		un_wp_page((unsigned long *) page);
+		wp_page((unsigned long *) page,address);
 	return;
 }
 
@@ -280,12 +476,23 @@ void get_empty_page(unsigned long address)
 {
 	unsigned long tmp;
 
-	if (!(tmp=get_free_page()) || !put_page(tmp,address)) {
+	if (!(tmp=get_user_page()) || !put_page(tmp,address)) {
 		free_page(tmp);		/* 0 is ok - ignored */
 		oom();
 	}
 }
 
+/*
+ * Only a write needs a page of its own: a read maps the zero page.
+ */
+static void do_anonymous_page(unsigned long error_code,unsigned long address)
+{
+	if (error_code & 2)
+		get_empty_page(address);
+	else if (!put_kernel_page(ZERO_PAGE,address))
+		oom();
+}
+
 /*
  * try_to_share() checks the page at address "address" in the task "p",
  * to see if it exists, and if it is clean. If so, share it with the current
@@ -297,14 +504,18 @@ void get_empty_page(unsigned long address)
 static int try_to_share(unsigned long address, struct task_struct * p)
 {
 	unsigned long from;
-	unsigned long to;
 	unsigned long from_page;
 	unsigned long to_page;
 	unsigned long phys_addr;
 
-	from_page = to_page = ((address>>20) & 0xffc);
-	from_page += ((p->start_code>>20) & 0xffc);
-	to_page += ((current->start_code>>20) & 0xffc);
+/* get_pte() may sleep: look at p only once it's done */
+	if (!(to_page = (unsigned long) get_pte(current->start_code + address)))
+		oom();
+/* a thread got here first */
+	if (*(unsigned long *) to_page)
+		return 1;
+	from_page = (unsigned long)
+		pg_dir_entry(task_pg_dir(p),p->start_code + address);
 /* is there a page-directory at from? */
 	from = *(unsigned long *) from_page;
 	if (!(from & 1))
@@ -318,21 +529,9 @@ static int try_to_share(unsigned long address, struct task_struct * p)
 	phys_addr &= 0xfffff000;
 	if (phys_addr >= HIGH_MEMORY || phys_addr < LOW_MEM)
 		return 0;
-	to = *(unsigned long *) to_page;
-	if (!(to & 1)) {
-		if ((to = get_free_page()))
-			*(unsigned long *) to_page = to | 7;
-		else
-			oom();
-	}
-	to &= 0xfffff000;
-	to_page = to + ((address>>10) & 0xffc);
-	if (1 & *(unsigned long *) to_page)
-		panic("try_to_share: to_page already exists");
-/* share them: write-protect */
+/* share them: write-protect. p isn't running, so its TLB is empty */
 	*(unsigned long *) from_page &= ~2;
 	*(unsigned long *) to_page = *(unsigned long *) from_page;
-	invalidate();
 	phys_addr -= LOW_MEM;
 	phys_addr >>= 12;
 	mem_map[phys_addr]++;
@@ -368,28 +567,167 @@ static int share_page(unsigned long address)
 	return 0;
 }
 
-void do_no_page(unsigned long error_code,unsigned long address)
+/*
+ * Executable pages come from the page cache. Pages that hold nothing
+ * but text are mapped from it directly, copy-on-write; the others get
+ * a private copy with the bss part cleared.
+ */
+static void do_mmap_page(struct vm_area_struct * area,
+	unsigned long error_code, unsigned long tmp, unsigned long address)
+{
+	unsigned long page;
+	int block;
+
+	if (!area->vm_inode) {
+/* shared pages have to be real before the fork() that shares them */
+		if ((area->vm_prot & PROT_WRITE) && (area->vm_flags & MAP_SHARED))
+			get_empty_page(address);
+		else if (area->vm_prot & PROT_WRITE)
+			do_anonymous_page(error_code,address);
+		else if (!put_kernel_page(ZERO_PAGE,address))
+			oom();
+		return;
+	}
+	block = (area->vm_offset + tmp - area->vm_start)/BLOCK_SIZE;
+/* a shared mapping must not be left with a copy of its own */
+	if (!(page = (area->vm_flags & MAP_SHARED) ?
+	    read_shared_page(area->vm_inode,block) :
+	    read_cache_page(area->vm_inode,block)))
+		oom();
+	if ((area->vm_flags & MAP_SHARED) && (area->vm_prot & PROT_WRITE)) {
+		if (install_page(page,address,7))
+			return;
+	} else if (put_shared_page(page,address))
+		return;
+	free_page(page);
+	oom();
+}
+
+/*
+ * A fault on executable text also maps the pages around it that can be
+ * had without waiting for the disk, in an aligned window of
+ * fault_around_pages, and starts reading the next window. A fresh
+ * exec() then takes a fault per window instead of one per page.
+ * faultaround() changes the window: 0 or 1 turns it off.
+ */
+static int fault_around_pages = 16;
+
+static void fault_around(unsigned long tmp)
+{
+	struct m_inode * inode = current->executable;
+	unsigned long size = fault_around_pages * PAGE_SIZE;
+	unsigned long start, end, page, *pte;
+
+	if (fault_around_pages <= 1)
+		return;
+	start = tmp & ~(size-1);
+	for (end = start + size ; start < end ; start += PAGE_SIZE) {
+		if (start + PAGE_SIZE > current->end_code)
+			return;
+		if (start == tmp)
+			continue;
+/* the window never leaves the page table of the faulting page */
+		if (!(pte = get_pte(current->start_code + start)))
+			return;
+		if (*pte)
+			continue;
+		if (!(page = try_cache_page(inode,1+start/BLOCK_SIZE)))
+			continue;
+		if (*pte)		/* we slept, and somebody mapped it */
+			free_page(page);
+		else
+			*pte = page | 5;
+	}
+	for (end += size ; start < end ; start += PAGE_SIZE) {
+		if (start + PAGE_SIZE > current->end_code)
+			return;
+		readahead_cache_page(inode,1+start/BLOCK_SIZE);
+	}
+}
+
+int sys_faultaround(int pages)
+{
+	int old = fault_around_pages;
+
+	if (pages < 0)
+		return old;
+	if (!suser())
+		return -EPERM;
+	if (pages > 64 || (pages & (pages-1)))
+		return -EINVAL;
+	fault_around_pages = pages;
+	return old;
+}
+
+/*
+ * do_swap_page() brings a page back in from swap. The task gets a
+ * private copy even if fork() had shared the slot.
+ */
+static void do_swap_page(struct vm_area_struct * area,
+	unsigned long * pte, unsigned long entry)
 {
-	int nr[4];
-	unsigned long tmp;
 	unsigned long page;
-	int block,i;
+
+	if (!(page = get_user_page()))
+		oom();
+	read_swap_page(SWP_NR(entry),(char *) page);
+	if (*pte != entry) {
+		free_page(page);
+		return;
+	}
+	if (area && !(area->vm_prot & PROT_WRITE))
+		*pte = page | 5;
+	else
+		*pte = page | 7;
+	swap_free(SWP_NR(entry));
+}
+
+void do_no_page(unsigned long error_code,unsigned long address)
+{
+	struct vm_area_struct * area;
+	unsigned long tmp, *pte;
+	unsigned long page, cached;
+	int i;
 
 	address &= 0xfffff000;
 	tmp = address - current->start_code;
+	area = find_vma(current,tmp);
+	pte = pg_dir_entry(task_pg_dir(current),address);
+	if (1 & *pte) {
+		pte = (unsigned long *) (0xfffff000 & *pte);
+		pte += (address>>12) & 0x3ff;
+		if (*pte && !(1 & *pte)) {
+			do_swap_page(area,pte,*pte);
+			return;
+		}
+	}
+	if (area) {
+		do_mmap_page(area,error_code,tmp,address);
+		return;
+	}
 	if (!current->executable || tmp >= current->end_data) {
-		get_empty_page(address);
+		do_anonymous_page(error_code,address);
 		return;
 	}
 	if (share_page(tmp))
 		return;
-	if (!(page = get_free_page()))
-		oom();
 /* remember that 1 block is used for header */
-	block = 1 + tmp/BLOCK_SIZE;
-	for (i=0 ; i<4 ; block++,i++)
-		nr[i] = bmap(current->executable,block);
-	bread_page(page,current->executable->i_dev,nr);
+	if (!(cached = read_cache_page(current->executable,1+tmp/BLOCK_SIZE)))
+		oom();
+	if (tmp + PAGE_SIZE <= current->end_code) {
+		if (put_shared_page(cached,address)) {
+			fault_around(tmp);
+			return;
+		}
+		free_page(cached);
+		oom();
+	}
+	if (!(page = get_user_page())) {
+		free_page(cached);
+		oom();
+	}
+	copy_page(cached,page);
+	free_page(cached);
 	i = tmp + 4096 - current->end_data;
 	tmp = page + 4096;
 	while (i-- > 0) {
@@ -430,7 +768,9 @@ void  mem_init(long start_mem, long end_mem)
     /* 将4M - end_mem 范围内的内存页标记为可用 */
     while (end_mem-- > 0) {
         mem_map[i++] = 0;
+        nr_free_pages++;
     }
+    nr_main_pages = nr_free_pages;
 }
 
 void calc_mem(void)
@@ -0,0 +1,285 @@
+/*
+ *  linux/mm/mmap.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * mmap() and munmap() only keep the list of areas: pages are brought in
+ * by do_no_page() from the page cache as they are touched, and private
+ * ones are copied by do_wp_page() when written. Shared areas map the
+ * cached pages writable, so read() sees writes at once; the file itself
+ * is updated when the area is unmapped, the task exits or execs.
+ *
+ * Anonymous areas have no inode and get zeroed pages. Unmapping them,
+ * or lowering the break with brk(), gives the pages back at once.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/pagemap.h>
+#include <linux/slab.h>
+#include <asm/segment.h>
+
+static struct kmem_cache vm_area_cache =
+	KMEM_CACHE("vm_area", struct vm_area_struct, NULL);
+
+struct vm_area_struct * find_vma(struct task_struct * task, unsigned long addr)
+{
+	struct vm_area_struct * area;
+
+	for (area = task->mm->mmap ; area ; area = area->vm_next) {
+		if (addr < area->vm_start)
+			return NULL;
+		if (addr < area->vm_end)
+			return area;
+	}
+	return NULL;
+}
+
+/*
+ * zap_pages() drops the pages of 'task' between start and end, after
+ * writing back the dirty ones if they belong to a shared file area.
+ * A few pages are dropped from the TLB one by one, more all at once.
+ */
+void zap_pages(struct task_struct * task, struct vm_area_struct * area,
+	unsigned long start, unsigned long end)
+{
+	unsigned long address, *dir, *pte, page;
+	int flush_all = end - start > 4*PAGE_SIZE;
+
+	for ( ; start < end ; start += PAGE_SIZE) {
+		address = task->start_code + start;
+		dir = pg_dir_entry(task_pg_dir(task),address);
+		if (!(1 & *dir))
+			continue;
+		pte = (unsigned long *) (0xfffff000 & *dir);
+		pte += (address>>12) & 0x3ff;
+		if (!(1 & *pte)) {
+			if (*pte)
+				swap_free(SWP_NR(*pte));
+			*pte = 0;
+			continue;
+		}
+		page = 0xfffff000 & *pte;
+		if (area && area->vm_inode && (area->vm_flags & MAP_SHARED)
+		    && (*pte & 0x40))
+			write_cache_page(area->vm_inode,
+				(area->vm_offset + start - area->vm_start)/BLOCK_SIZE,
+				page);
+		*pte = 0;
+		free_page(page);
+		if (!flush_all && task->mm == current->mm)
+			invalidate_page(address);
+	}
+	if (flush_all && task->mm == current->mm)
+		invalidate();
+}
+
+static void free_area(struct vm_area_struct * area)
+{
+	iput(area->vm_inode);
+	kmem_cache_free(&vm_area_cache,area);
+}
+
+/*
+ * The caller has made sure the new area doesn't overlap an old one.
+ */
+static void insert_area(struct vm_area_struct * area)
+{
+	struct vm_area_struct ** p;
+
+	for (p = &current->mm->mmap ; *p ; p = &(*p)->vm_next)
+		if ((*p)->vm_start > area->vm_start)
+			break;
+	area->vm_next = *p;
+	*p = area;
+}
+
+/*
+ * Find 'len' bytes between MMAP_BASE and MMAP_END that no area uses.
+ */
+static unsigned long get_unmapped_area(unsigned long len)
+{
+	struct vm_area_struct * area;
+	unsigned long addr = MMAP_BASE;
+
+	for (area = current->mm->mmap ; area ; area = area->vm_next) {
+		if (area->vm_start >= addr + len)
+			break;
+		if (area->vm_end > addr)
+			addr = area->vm_end;
+	}
+	if (addr + len > MMAP_END)
+		return 0;
+	return addr;
+}
+
+static int do_munmap(unsigned long addr, unsigned long len)
+{
+	struct vm_area_struct ** p, * area, * tail;
+	unsigned long end = addr + len;
+
+	p = &current->mm->mmap;
+	while ((area = *p)) {
+		if (area->vm_end <= addr) {
+			p = &area->vm_next;
+			continue;
+		}
+		if (area->vm_start >= end)
+			break;
+		if (area->vm_start < addr && area->vm_end > end) {
+			if (!(tail = kmem_cache_alloc(&vm_area_cache)))
+				return -ENOMEM;
+			*tail = *area;
+			tail->vm_start = end;
+			tail->vm_offset += end - area->vm_start;
+			if (tail->vm_inode)
+				tail->vm_inode->i_count++;
+			zap_pages(current,area,addr,end);
+			area->vm_end = addr;
+			area->vm_next = tail;
+			break;
+		}
+		if (area->vm_start < addr) {
+			zap_pages(current,area,addr,area->vm_end);
+			area->vm_end = addr;
+			p = &area->vm_next;
+			continue;
+		}
+		if (area->vm_end > end) {
+			zap_pages(current,area,area->vm_start,end);
+			area->vm_offset += end - area->vm_start;
+			area->vm_start = end;
+			break;
+		}
+		zap_pages(current,area,area->vm_start,area->vm_end);
+		*p = area->vm_next;
+		free_area(area);
+	}
+	return 0;
+}
+
+static int do_mmap(unsigned long addr, unsigned long len, int prot,
+	int flags, int fd, unsigned long off)
+{
+	struct vm_area_struct * area;
+	struct m_inode * inode;
+	struct file * file;
+	int mode, error;
+
+	len = PAGE_ALIGN(len);
+	if (!len || (off & (PAGE_SIZE-1)))
+		return -EINVAL;
+	if ((flags & (MAP_SHARED|MAP_PRIVATE)) == 0 ||
+	    (flags & (MAP_SHARED|MAP_PRIVATE)) == (MAP_SHARED|MAP_PRIVATE))
+		return -EINVAL;
+	if (flags & MAP_ANONYMOUS) {
+		inode = NULL;
+		off = 0;
+	} else {
+/* bmap() panics on blocks past the double indirect ones */
+		if (off + len < off || (off + len) / BLOCK_SIZE > MAX_FILE_BLOCKS)
+			return -EINVAL;
+		if (fd >= NR_OPEN || fd < 0 || !(file = current->files->fd[fd]))
+			return -EBADF;
+		inode = file->f_inode;
+		if (!inode || !S_ISREG(inode->i_mode))
+			return -EACCES;
+		mode = file->f_flags & O_ACCMODE;
+		if (mode == O_WRONLY)
+			return -EACCES;
+		if ((flags & MAP_SHARED) && (prot & PROT_WRITE) &&
+		    mode != O_RDWR)
+			return -EACCES;
+	}
+	if (flags & MAP_FIXED) {
+		if (addr & (PAGE_SIZE-1))
+			return -EINVAL;
+		if (addr < PAGE_ALIGN(current->mm->brk) || addr + len > MMAP_END ||
+		    addr + len < addr)
+			return -EINVAL;
+		if ((error = do_munmap(addr,len)))
+			return error;
+	} else if (!(addr = get_unmapped_area(len)))
+		return -ENOMEM;
+	if (!(area = kmem_cache_alloc(&vm_area_cache)))
+		return -ENOMEM;
+/* anything touched here before the mmap() goes away */
+	zap_pages(current,NULL,addr,addr+len);
+	area->vm_start = addr;
+	area->vm_end = addr + len;
+	area->vm_flags = flags & (MAP_SHARED|MAP_PRIVATE);
+	area->vm_prot = prot;
+	area->vm_inode = inode;
+	area->vm_offset = off;
+	if (inode)
+		inode->i_count++;
+	insert_area(area);
+	return addr;
+}
+
+/*
+ * mmap() takes six arguments, more than fit in registers, so the
+ * library passes a pointer to them.
+ */
+int sys_mmap(unsigned long * buffer)
+{
+	unsigned long arg[6];
+	int i;
+
+	for (i=0 ; i<6 ; i++)
+		arg[i] = get_fs_long(buffer+i);
+	return do_mmap(arg[0],arg[1],arg[2],arg[3],arg[4],arg[5]);
+}
+
+int sys_munmap(unsigned long addr, unsigned long len)
+{
+	if ((addr & (PAGE_SIZE-1)) || !len || addr + len < addr)
+		return -EINVAL;
+	return do_munmap(addr,PAGE_ALIGN(len));
+}
+
+/*
+ * copy_mmap() gives a new child copies of its parent's areas, after
+ * copy_mem() has copied the pages themselves.
+ */
+int copy_mmap(struct task_struct * p)
+{
+	struct vm_area_struct * area, ** tail;
+
+	p->mm->mmap = NULL;
+	tail = &p->mm->mmap;
+	for (area = current->mm->mmap ; area ; area = area->vm_next) {
+		if (!(*tail = kmem_cache_alloc(&vm_area_cache))) {
+			exit_mmap(p);
+			return -ENOMEM;
+		}
+		**tail = *area;
+		(*tail)->vm_next = NULL;
+		if (area->vm_inode)
+			area->vm_inode->i_count++;
+		tail = &(*tail)->vm_next;
+	}
+	return 0;
+}
+
+/*
+ * exit_mmap() is called by exit() and execve() before they free the
+ * page tables, so that shared areas get written back.
+ */
+void exit_mmap(struct task_struct * p)
+{
+	struct vm_area_struct * area;
+
+	while ((area = p->mm->mmap)) {
+		zap_pages(p,area,area->vm_start,area->vm_end);
+		p->mm->mmap = area->vm_next;
+		free_area(area);
+	}
+}
@@ -0,0 +1,313 @@
+/*
+ *  linux/mm/slab.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * The object caches. Every page of a cache starts with a struct slab,
+ * followed by a byte per object that links the free objects of the page
+ * together, and then the objects. So the page of an object, and with it
+ * the cache, is found by masking the address: free needs no size and no
+ * search.
+ *
+ * A cache keeps pages with free objects on its partial list and takes
+ * objects from the first one, so pages in use fill up before new ones
+ * are started. A page that becomes all free is kept in 'empty' if that
+ * is unused, else given back at once; kmem_cache_reap() takes back the
+ * empty ones too when get_free_page() runs low.
+ *
+ * All of it may be used from interrupts (add_timer() is), so the locks
+ * are taken with interrupts off, and get_free_page() is only called
+ * with none held.
+ *
+ * malloc() and free_s() are on top of this, with a cache for each power
+ * of two from 16 to 2048 bytes.
+ */
+
+#include <stddef.h>
+#include <errno.h>
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/slabstat.h>
+#include <asm/system.h>
+#include <asm/segment.h>
+
+#define SLAB_MAGIC 0x51ab51ab
+#define BUFCTL_END 255
+
+struct slab {
+	unsigned long magic;
+	struct kmem_cache * cache;
+	struct slab * next, * prev;	/* on the partial list */
+	int inuse;
+	int free;			/* first free object, or BUFCTL_END */
+};
+
+#define slab_bufctl(s) ((unsigned char *) ((s)+1))
+
+static struct kmem_cache * cache_chain = NULL;
+static spinlock_t cache_chain_lock = SPIN_LOCK_UNLOCKED;
+
+/*
+ * Work out the layout of a page on the first allocation, and put the
+ * cache on the chain that reap and slabstat walk. Objects are at least
+ * 16 bytes, which keeps the number per page below BUFCTL_END.
+ */
+static void cache_setup(struct kmem_cache * c)
+{
+	unsigned long flags;
+	int objsize, num, offset;
+
+	spin_lock_irqsave(&cache_chain_lock,flags);
+	if (c->num) {
+		spin_unlock_irqrestore(&cache_chain_lock,flags);
+		return;
+	}
+	objsize = (c->size + 3) & ~3;
+	if (objsize < 16)
+		objsize = 16;
+	num = (PAGE_SIZE - sizeof (struct slab)) / (objsize + 1);
+	if (num < 1)
+		panic("kmem_cache: object too large");
+	for (;;) {
+		offset = (sizeof (struct slab) + num + 3) & ~3;
+		if (offset + num * objsize <= PAGE_SIZE)
+			break;
+		num--;
+	}
+	c->objsize = objsize;
+	c->offset = offset;
+	c->next = cache_chain;
+	cache_chain = c;
+	c->num = num;
+	spin_unlock_irqrestore(&cache_chain_lock,flags);
+}
+
+static inline void slab_link(struct kmem_cache * c, struct slab * s)
+{
+	s->prev = NULL;
+	if ((s->next = c->partial) != NULL)
+		s->next->prev = s;
+	c->partial = s;
+}
+
+static inline void slab_unlink(struct kmem_cache * c, struct slab * s)
+{
+	if (s->next)
+		s->next->prev = s->prev;
+	if (s->prev)
+		s->prev->next = s->next;
+	else
+		c->partial = s->next;
+}
+
+/*
+ * Add a new page to the cache, as its empty page. If somebody else
+ * added one meanwhile, ours goes back: the caller only wants to retry.
+ */
+static int cache_grow(struct kmem_cache * c)
+{
+	struct slab * s;
+	unsigned long flags;
+	char * obj;
+	int i;
+
+	if (!(s = (struct slab *) get_free_page()))
+		return 0;
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->inuse = 0;
+	s->free = 0;
+	obj = c->offset + (char *) s;
+	for (i=0 ; i<c->num ; i++, obj += c->objsize) {
+		slab_bufctl(s)[i] = i+1;
+		if (c->ctor)
+			c->ctor(obj);
+	}
+	slab_bufctl(s)[c->num-1] = BUFCTL_END;
+	spin_lock_irqsave(&c->lock,flags);
+	if (c->empty) {
+		spin_unlock_irqrestore(&c->lock,flags);
+		free_page((unsigned long) s);
+		return 1;
+	}
+	c->empty = s;
+	c->pages++;
+	c->grown++;
+	spin_unlock_irqrestore(&c->lock,flags);
+	return 1;
+}
+
+void * kmem_cache_alloc(struct kmem_cache * c)
+{
+	struct slab * s;
+	unsigned long flags;
+	void * obj;
+
+	if (!c->num)
+		cache_setup(c);
+	spin_lock_irqsave(&c->lock,flags);
+	while (!(s = c->partial)) {
+		if ((s = c->empty) != NULL) {
+			c->empty = NULL;
+			slab_link(c,s);
+			break;
+		}
+		spin_unlock_irqrestore(&c->lock,flags);
+		if (!cache_grow(c))
+			return NULL;
+		spin_lock_irqsave(&c->lock,flags);
+	}
+	obj = c->offset + s->free * c->objsize + (char *) s;
+	s->free = slab_bufctl(s)[s->free];
+	s->inuse++;
+	if (s->free == BUFCTL_END)
+		slab_unlink(c,s);
+	c->active++;
+	c->allocs++;
+	spin_unlock_irqrestore(&c->lock,flags);
+	return obj;
+}
+
+static struct slab * obj_slab(void * obj)
+{
+	struct slab * s;
+
+	s = (struct slab *) ((unsigned long) obj & ~(PAGE_SIZE-1));
+	if (!obj || s->magic != SLAB_MAGIC)
+		panic("kmem_cache: bad object address");
+	return s;
+}
+
+void kmem_cache_free(struct kmem_cache * c, void * obj)
+{
+	struct slab * s = obj_slab(obj);
+	unsigned long flags;
+	int i;
+
+	if (s->cache != c)
+		panic("kmem_cache_free: object of another cache");
+	i = ((char *) obj - c->offset - (char *) s) / c->objsize;
+	spin_lock_irqsave(&c->lock,flags);
+	if (s->free == BUFCTL_END)
+		slab_link(c,s);
+	slab_bufctl(s)[i] = s->free;
+	s->free = i;
+	c->active--;
+	c->frees++;
+	if (--s->inuse) {
+		spin_unlock_irqrestore(&c->lock,flags);
+		return;
+	}
+	slab_unlink(c,s);
+	if (!c->empty) {
+		c->empty = s;
+		s = NULL;
+	} else {
+		c->pages--;
+		c->shrunk++;
+	}
+	spin_unlock_irqrestore(&c->lock,flags);
+	if (s)
+		free_page((unsigned long) s);
+}
+
+/*
+ * kmem_cache_reap() is called by get_free_page() when memory runs low,
+ * and gives back the empty pages the caches keep. Returns the number of
+ * pages freed.
+ */
+int kmem_cache_reap(int pages)
+{
+	struct kmem_cache * c;
+	struct slab * s;
+	unsigned long flags, cflags;
+	int freed = 0;
+
+	spin_lock_irqsave(&cache_chain_lock,flags);
+	for (c = cache_chain ; c && freed < pages ; c = c->next) {
+		spin_lock_irqsave(&c->lock,cflags);
+		if ((s = c->empty) != NULL) {
+			c->empty = NULL;
+			c->pages--;
+			c->shrunk++;
+		}
+		spin_unlock_irqrestore(&c->lock,cflags);
+		if (s) {
+			free_page((unsigned long) s);
+			freed++;
+		}
+	}
+	spin_unlock_irqrestore(&cache_chain_lock,flags);
+	return freed;
+}
+
+static struct kmem_cache size_cache[] = {
+	KMEM_CACHE("size-16", char [16], NULL),
+	KMEM_CACHE("size-32", char [32], NULL),
+	KMEM_CACHE("size-64", char [64], NULL),
+	KMEM_CACHE("size-128", char [128], NULL),
+	KMEM_CACHE("size-256", char [256], NULL),
+	KMEM_CACHE("size-512", char [512], NULL),
+	KMEM_CACHE("size-1024", char [1024], NULL),
+	KMEM_CACHE("size-2048", char [2048], NULL),
+};
+
+#define NR_SIZE_CACHES (sizeof (size_cache) / sizeof (struct kmem_cache))
+
+void * malloc(unsigned int len)
+{
+	int i;
+
+	for (i=0 ; i<NR_SIZE_CACHES ; i++)
+		if (size_cache[i].size >= len)
+			return kmem_cache_alloc(size_cache+i);
+	printk("malloc called with impossibly large argument (%d)\n",len);
+	panic("malloc: bad arg");
+	return NULL;
+}
+
+/* the size isn't needed any more, the page knows its cache */
+void free_s(void * obj, int size)
+{
+	kmem_cache_free(obj_slab(obj)->cache,obj);
+}
+
+int sys_slabstat(int nr, struct slab_stat * buf)
+{
+	struct kmem_cache * c;
+	struct slab_stat st;
+	unsigned long flags;
+	int i;
+
+	if (nr < 0)
+		return -EINVAL;
+	spin_lock_irqsave(&cache_chain_lock,flags);
+	for (c = cache_chain ; c && nr ; c = c->next)
+		nr--;
+	spin_unlock_irqrestore(&cache_chain_lock,flags);
+	if (!c)
+		return -ENOENT;
+	for (i=0 ; i<sizeof st.name-1 && c->name[i] ; i++)
+		st.name[i] = c->name[i];
+	while (i < sizeof st.name)
+		st.name[i++] = 0;
+	spin_lock_irqsave(&c->lock,flags);
+	st.size = c->objsize;
+	st.num = c->num;
+	st.active = c->active;
+	st.allocs = c->allocs;
+	st.frees = c->frees;
+	st.pages = c->pages;
+	st.grown = c->grown;
+	st.shrunk = c->shrunk;
+	spin_unlock_irqrestore(&c->lock,flags);
+	if (verify_area(buf,sizeof *buf))
+		return -EFAULT;
+	for (i=0 ; i<sizeof *buf ; i++)
+		put_fs_byte(((char *) &st)[i],i+(char *) buf);
+	return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ *  linux/mm/swap.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * Swapping out pages of user tasks to a block device. swapon() reads
+ * the first page of the device, which has to end in "SWAP-SPACE" and
+ * hold a bitmap of the usable pages in front of it (the same layout
+ * mkswap writes), and from then on page faults that find no free
+ * memory push task pages out instead of killing the task.
+ *
+ * A page that has been swapped out leaves a non-present entry in the
+ * page table: the slot number shifted left by one, so bit 0 is clear.
+ * fork() shares the slot and swap_map[] counts the users.
+ *
+ * swap_out() is a clock over the page tables of all tasks but task 0,
+ * giving pages that the hardware marked accessed a second chance. Only
+ * pages nobody shares are taken: shared pages, cached file pages and
+ * shared mappings stay in memory.
+ */
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <linux/config.h>
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <asm/system.h>
+
+#define SWAP_PAGES 4096		/* 16MB of swap, a page of counts */
+#define SWAP_BAD 0xff		/* the slot is not usable */
+#define SWAP_BITS ((4096-10)*8)	/* bits of bitmap in the header page */
+
+static int swap_dev = 0;
+static int nr_swap_pages = 0;
+static int swap_hint = 1;
+static unsigned char swap_map[SWAP_PAGES];
+static unsigned long swap_lockmap[SWAP_PAGES/32];
+static struct task_struct * swap_wait = NULL;
+
+extern void zram_discard(int block, int count);
+
+#define TASK_PAGES (TASK_SIZE >> 12)
+
+/* clock hand: task number and page within its task space */
+static int swap_task = 1;
+static unsigned long swap_page = 0;
+
+#define swap_locked(nr) (swap_lockmap[(nr)>>5] & (1 << ((nr) & 31)))
+#define lock_swap(nr) (swap_lockmap[(nr)>>5] |= 1 << ((nr) & 31))
+#define unlock_swap(nr) (swap_lockmap[(nr)>>5] &= ~(1 << ((nr) & 31)))
+
+/*
+ * The swap device is read and written a page at a time through four
+ * buffer heads of our own, so swap I/O bypasses the buffer cache.
+ * Returns 0 if any of the blocks failed.
+ */
+static int rw_swap_page(int rw, int nr, char * buf)
+{
+	struct buffer_head bh[4];
+	int i, ok = 1;
+
+	for (i=0 ; i<4 ; i++) {
+		bh[i].b_data = buf + i*BLOCK_SIZE;
+		bh[i].b_dev = swap_dev;
+		bh[i].b_blocknr = nr*4 + i;
+		bh[i].b_uptodate = 0;
+		bh[i].b_dirt = (rw == WRITE);
+		bh[i].b_count = 1;
+		mutex_init(&bh[i].b_lock);
+		bh[i].b_next = bh[i].b_prev = NULL;
+		bh[i].b_prev_free = bh[i].b_next_free = NULL;
+		ll_rw_block(rw,bh+i);
+	}
+	for (i=0 ; i<4 ; i++) {
+		mutex_wait(&bh[i].b_lock);
+		if (!bh[i].b_uptodate)
+			ok = 0;
+	}
+	if (!ok)
+		printk("swap: I/O error on page %d\n\r",nr);
+	return ok;
+}
+
+void read_swap_page(int nr, char * buf)
+{
+	while (swap_locked(nr))
+		sleep_on(&swap_wait);
+	rw_swap_page(READ,nr,buf);
+}
+
+void swap_free(int nr)
+{
+	if (nr <= 0 || nr >= SWAP_PAGES || swap_map[nr] == SWAP_BAD ||
+	    !swap_map[nr]) {
+		printk("swap_free: bad swap entry %d\n\r",nr);
+		return;
+	}
+	if (!--swap_map[nr]) {
+		nr_swap_pages++;
+		if (swap_dev == ZRAM_DEV)
+			zram_discard(nr*4,4);
+	}
+}
+
+void swap_duplicate(int nr)
+{
+	if (nr <= 0 || nr >= SWAP_PAGES || swap_map[nr] == SWAP_BAD ||
+	    !swap_map[nr]) {
+		printk("swap_duplicate: bad swap entry %d\n\r",nr);
+		return;
+	}
+	swap_map[nr]++;
+}
+
+static int get_swap_slot(void)
+{
+	int i, nr;
+
+	if (!nr_swap_pages)
+		return 0;
+	for (i=1 ; i<SWAP_PAGES ; i++) {
+		nr = swap_hint;
+		if (++swap_hint >= SWAP_PAGES)
+			swap_hint = 1;
+		if (!swap_map[nr] && !swap_locked(nr)) {
+			swap_map[nr] = 1;
+			nr_swap_pages--;
+			return nr;
+		}
+	}
+	return 0;
+}
+
+/*
+ * A write to swap failed after the page table entry was changed. Every
+ * entry that still refers to the slot gets the page back: fork() may
+ * have copied the entry meanwhile, so there can be more than one, and
+ * then they share the page copy-on-write. This walks all page tables,
+ * but only when a write fails.
+ */
+static void unswap_page(int nr, unsigned long entry)
+{
+	struct task_struct * p;
+	unsigned long * dir, * pte, page = 0xfffff000 & entry;
+	int i, j, k, mapped = 0;
+
+	if (swap_map[nr] > 1)
+		entry &= ~2;
+	for (i=1 ; i<NR_TASKS ; i++) {
+		if (!(p = task[i]))
+			continue;
+		dir = pg_dir_entry(task_pg_dir(p),p->start_code);
+		for (j=0 ; j<TASK_PAGES/1024 ; j++, dir++) {
+			if (!(1 & *dir))
+				continue;
+			pte = (unsigned long *) (0xfffff000 & *dir);
+			for (k=0 ; k<1024 ; k++, pte++) {
+				if (*pte != SWP_ENTRY(nr))
+					continue;
+				*pte = entry;
+				if (mapped++)
+					mem_map[MAP_NR(page)]++;
+				swap_free(nr);
+			}
+		}
+	}
+	if (!mapped)
+		free_page(page);
+}
+
+/*
+ * swap_out() writes one page to swap and frees it. It returns 0 if
+ * there is no swap, it is full, or two sweeps over all tasks found
+ * nothing to take. A sweep looks at every resident page at most
+ * twice, so it is bounded by memory, not by the size of task space.
+ */
+int swap_out(void)
+{
+	struct task_struct * p;
+	struct vm_area_struct * area;
+	unsigned long * dir, * pte, page, address, entry;
+	long steps = 0;
+	int nr, sweeps = 0;
+
+	while (steps < 2L*PAGING_PAGES && nr_swap_pages) {
+		if (swap_page >= TASK_PAGES) {
+			swap_page = 0;
+			if (++swap_task >= NR_TASKS) {
+				swap_task = 1;
+				if (++sweeps > 2)
+					break;
+			}
+		}
+		if (!(p = task[swap_task])) {
+			swap_page = TASK_PAGES;
+			continue;
+		}
+		address = p->start_code + (swap_page << 12);
+		dir = pg_dir_entry(task_pg_dir(p),address);
+		if (!(1 & *dir)) {
+			swap_page = (swap_page + 1024) & ~1023;
+			continue;
+		}
+		pte = (unsigned long *) (0xfffff000 & *dir);
+		pte += swap_page & 1023;
+		swap_page++;
+		if (!(1 & *pte))
+			continue;
+		steps++;
+		page = 0xfffff000 & *pte;
+		if (page < LOW_MEM || mem_map[MAP_NR(page)] != 1)
+			continue;
+		if (*pte & 0x20) {
+			*pte &= ~0x20;
+			continue;
+		}
+		area = find_vma(p,(swap_page-1) << 12);
+		if (area && (area->vm_flags & MAP_SHARED))
+			continue;
+		if (!(nr = get_swap_slot()))
+			break;
+		entry = *pte;
+		*pte = SWP_ENTRY(nr);
+/* clone(CLONE_VM) siblings of current share its tlb entries */
+		if (p->mm == current->mm)
+			invalidate_page(address);
+		lock_swap(nr);
+		if (!rw_swap_page(WRITE,nr,(char *) page)) {
+/* a full zram device fails writes: keep the page then */
+			if (*pte == SWP_ENTRY(nr) && swap_map[nr] == 1) {
+				*pte = entry;
+				swap_free(nr);
+			} else
+				unswap_page(nr,entry);
+			unlock_swap(nr);
+			wake_up(&swap_wait);
+			break;
+		}
+		unlock_swap(nr);
+		wake_up(&swap_wait);
+		free_page(page);
+		return 1;
+	}
+	invalidate();
+	return 0;
+}
+
+int sys_swapon(const char * specialfile)
+{
+	struct m_inode * inode;
+	unsigned long page;
+	int i, dev;
+
+	if (!suser())
+		return -EPERM;
+	if (swap_dev)
+		return -EBUSY;
+	if (!(inode = namei(specialfile)))
+		return -ENOENT;
+	dev = inode->i_zone[0];
+	if (!S_ISBLK(inode->i_mode)) {
+		iput(inode);
+		return -ENOTBLK;
+	}
+	iput(inode);
+	if (!(page = get_free_page()))
+		return -ENOMEM;
+	swap_dev = dev;
+	rw_swap_page(READ,0,(char *) page);
+	for (i=0 ; i<10 ; i++)
+		if (((char *) page)[4086+i] != "SWAP-SPACE"[i])
+			break;
+	if (i < 10) {
+		printk("Unable to find swap-space signature\n\r");
+		free_page(page);
+		swap_dev = 0;
+		return -EINVAL;
+	}
+	nr_swap_pages = 0;
+	swap_map[0] = SWAP_BAD;
+	for (i=1 ; i<SWAP_PAGES ; i++)
+		if (i < SWAP_BITS && (((char *) page)[i>>3] & (1 << (i & 7)))) {
+			swap_map[i] = 0;
+			nr_swap_pages++;
+		} else
+			swap_map[i] = SWAP_BAD;
+	free_page(page);
+	if (!nr_swap_pages) {
+		printk("Empty swap-file\n\r");
+		swap_dev = 0;
+		return -EINVAL;
+	}
+	printk("Adding swap: %d pages (%d bytes) swap-space\n\r",
+		nr_swap_pages,nr_swap_pages*4096);
+	return 0;
+}
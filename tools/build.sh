@@ -10,8 +10,9 @@ IMAGE=$4
 root_dev=$5
 
 # Set the biggest sys_size
-# Changes from 0x20000 to 0x30000 by tigercn to avoid oversized code.
-SYS_SIZE=$((0x3000*16))
+# Changes from 0x20000 to 0x30000 by tigercn to avoid oversized code,
+# and to 0x40000 along with SYSSIZE in bootsect.s.
+SYS_SIZE=$((0x4000*16))
 
 # set the default "device" file for root image file
 if [ -z "$root_dev" ]; then